@@ -0,0 +1,393 @@
+#include <raylib-cpp.hpp>
+#include <nlohmann/json.hpp>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <Utils.hpp>
+#include <Attribute.hpp>
+#include <CityMap.hpp>
+#include <Effect.hpp>
+#include <Event.hpp>
+#include <EventHandler.hpp>
+#include <Hero.hpp>
+#include <HeroesHandler.hpp>
+#include <Mission.hpp>
+#include <MissionsHandler.hpp>
+#include <Power.hpp>
+#include <WorkerPool.hpp>
+#include <TimerWheel.hpp>
+#include <DenseSet.hpp>
+#include <Schedule.hpp>
+#include <Dispatcher.hpp>
+#include <OutcomeSimulator.hpp>
+#include <TeamScorer.hpp>
+#include <HeroIndex.hpp>
+
+using nlohmann::json;
+
+// Globals normally provided by Main.cpp / Headless.cpp
+float bgScale = 1.0f;
+raylib::Vector2 screenSize{960, 540};
+
+// Allocation counting, every heap allocation in the process goes through here
+namespace { std::atomic<unsigned long long> allocations{0}; }
+void* operator new(std::size_t size) {
+	allocations.fetch_add(1, std::memory_order_relaxed);
+	if (void* ptr = std::malloc(size ? size : 1)) return ptr;
+	throw std::bad_alloc{};
+}
+void* operator new[](std::size_t size) { return ::operator new(size); }
+void operator delete(void* ptr) noexcept { std::free(ptr); }
+void operator delete[](void* ptr) noexcept { std::free(ptr); }
+void operator delete(void* ptr, std::size_t) noexcept { std::free(ptr); }
+void operator delete[](void* ptr, std::size_t) noexcept { std::free(ptr); }
+
+namespace {
+	struct Options {
+		int heroes = 64, missions = 64;
+		long iterations = 100000;
+		unsigned int seed = 1;
+		long threads = -1;
+		std::string out = "bench.json", compare, filter;
+	};
+
+	struct Result {
+		std::string name;
+		long ops;
+		double nsPerOp, allocsPerOp;
+	};
+
+	volatile long long sink = 0;
+
+	void printUsage(const char* exe) {
+		Utils::println("Usage: {} [--heroes N] [--missions N] [--iterations N] [--seed N] [--threads N] [--filter TEXT] [--out FILE] [--compare BASELINE]", exe);
+		Utils::println("  --heroes      synthetic roster size (default 64)");
+		Utils::println("  --missions    synthetic mission count (default 64)");
+		Utils::println("  --iterations  timed operations per benchmark (default 100000)");
+		Utils::println("  --seed        seed for the synthetic data (default 1)");
+		Utils::println("  --threads     worker threads next to the main one (default one less than the cores)");
+		Utils::println("  --filter      only run benchmarks whose name contains TEXT");
+		Utils::println("  --out         JSON results file (default bench.json)");
+		Utils::println("  --compare     JSON results of a previous run to compare against");
+	}
+
+	Options parseArgs(int argc, char** argv) {
+		Options opts;
+		for (int i = 1; i < argc; i++) {
+			std::string arg = argv[i];
+			auto next = [&]() -> std::string {
+				if (i + 1 >= argc) throw std::invalid_argument(std::format("Missing value for {}", arg));
+				return argv[++i];
+			};
+			if (arg == "--heroes") opts.heroes = std::stoi(next());
+			else if (arg == "--missions") opts.missions = std::stoi(next());
+			else if (arg == "--iterations") opts.iterations = std::stol(next());
+			else if (arg == "--seed") opts.seed = std::stoul(next());
+			else if (arg == "--threads") opts.threads = std::stol(next());
+			else if (arg == "--filter") opts.filter = next();
+			else if (arg == "--out") opts.out = next();
+			else if (arg == "--compare") opts.compare = next();
+			else if (arg == "--help" || arg == "-h") {
+				printUsage(argv[0]);
+				std::exit(0);
+			} else throw std::invalid_argument(std::format("Unknown argument '{}'", arg));
+		}
+		if (opts.heroes <= 0 || opts.missions <= 0 || opts.iterations <= 0) throw std::invalid_argument("--heroes, --missions and --iterations must be positive");
+		if (opts.threads < -1) throw std::invalid_argument("--threads must not be negative");
+		return opts;
+	}
+
+	// Effect archetypes modelled on the shipped heroes, covering constant and string-sourced operations
+	json effectJson(int archetype) {
+		auto reset = [](const std::string& attr) { return json::array({json::array({attr, "=", 0})}); };
+		switch (archetype) {
+			case 0: return {{"type", "AttrBonusEffect"}, {"operations", {{"MissionStart", json::array({json::array({"COMBAT", "=", 1})})}, {"MissionSuccess", reset("COMBAT")}, {"MissionFailure", reset("COMBAT")}}}};
+			case 1: return {{"type", "AttrBonusEffect"}, {"appliesTo", "OTHERS"}, {"slotRestriction", 0}, {"operations", {{"MissionStart", json::array({json::array({"COMBAT", "=", 1})})}, {"MissionSuccess", reset("COMBAT")}, {"MissionFailure", reset("COMBAT")}}}};
+			case 2: return {{"type", "AttrBonusEffect"}, {"operations", {{"MissionStart", json::array({json::array({"COMBAT", "+", "excessCharisma"})})}, {"MissionSuccess", reset("COMBAT")}, {"MissionFailure", reset("COMBAT")}}}};
+			case 3: return {{"type", "AttrBonusEffect"}, {"operations", {{"MissionStart", json::array({json::array({"heroLowest", "+", 1}), json::array({"missionHighest", "+", "heroHighest"})})}, {"MissionSuccess", reset("VIGOR")}}}};
+			case 4: return {{"type", "AttrBonusEffect"}, {"appliesTo", "RIGHT"}, {"operations", {{"MissionStart", json::array({json::array({"MOBILITY", "=", 1})})}, {"MissionSuccess", reset("MOBILITY")}, {"MissionFailure", reset("MOBILITY")}}}};
+			default: return {{"type", "AttrBonusEffect"}, {"appliesTo", "ALL_LEFT"}, {"operations", {{"MissionStart", json::array({json::array({"VIGOR", "+", "missingVigor"})})}, {"MissionFailure", reset("VIGOR")}}}};
+		}
+	}
+	constexpr int EFFECT_ARCHETYPES = 6;
+
+	json heroJson(int idx, std::mt19937& rng) {
+		std::uniform_int_distribution<int> attr(1, 6);
+		json powers = json::array();
+		for (int p = 0; p < 2; p++) powers.push_back({
+			{"name", std::format("Bench Power {}", p)},
+			{"unlocked", true},
+			{"effects", json::array({effectJson((idx + 3 * p) % EFFECT_ARCHETYPES)})},
+		});
+		return {
+			{"name", std::format("Bench Hero {}", idx)},
+			{"attributes", {{"combat", attr(rng)}, {"vigor", attr(rng)}, {"mobility", attr(rng)}, {"charisma", attr(rng)}, {"intelligence", attr(rng)}}},
+			{"powers", powers},
+		};
+	}
+
+	json missionJson(int idx, std::mt19937& rng) {
+		std::uniform_int_distribution<int> attr(0, 10), slots(1, 4), difficulty(1, 5), x(50, 900), y(50, 350);
+		return {
+			{"name", std::format("Bench Mission {}", idx)},
+			{"type", "Assault"},
+			{"caller", "Bench"},
+			{"description", "Synthetic benchmark mission."},
+			{"requirements", json::array({"Bench"})},
+			{"attributes", {{"combat", attr(rng)}, {"vigor", attr(rng)}, {"mobility", attr(rng)}, {"charisma", attr(rng)}, {"intelligence", attr(rng)}}},
+			{"position", json::array({x(rng), y(rng)})},
+			{"slots", slots(rng)},
+			{"difficulty", difficulty(rng)},
+			{"failure", {{"duration", 60}}},
+			{"success", {{"duration", 20}}},
+		};
+	}
+
+	// Replaces the shipped content with a synthetic roster, assigning heroes to missions until they run out
+	void buildWorld(const Options& opts) {
+		auto& hh = HeroesHandler::inst();
+		auto& mh = MissionsHandler::inst();
+		std::mt19937 rng(opts.seed);
+
+		mh.clear();
+		hh.clear();
+		// Drops the spawn timer too, nothing fires in the benchmarks unless they schedule it
+		TimerWheel::inst().clear();
+
+		for (int i = 0; i < opts.heroes; i++) hh.roster.push_back(hh.addHero(heroJson(i, rng)));
+		size_t next = 0;
+		for (int i = 0; i < opts.missions; i++) {
+			MissionId id = mh.addMission(std::make_unique<Mission>(missionJson(i, rng)));
+			mh.active.insert(id);
+			auto& ms = mh[id];
+			for (int s = 0; s < ms.slots && next < hh.roster.size(); s++) ms.assignHero(hh.roster[next++]);
+		}
+	}
+
+	Result run(const std::string& name, long iterations, const std::function<long long(long)>& op) {
+		long warmup = std::min<long>(iterations / 10, 1000);
+		for (long i = 0; i < warmup; i++) sink = sink + op(i);
+
+		unsigned long long allocsBefore = allocations.load(std::memory_order_relaxed);
+		auto start = std::chrono::steady_clock::now();
+		long long acc = 0;
+		for (long i = 0; i < iterations; i++) acc += op(i);
+		std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+		unsigned long long allocsAfter = allocations.load(std::memory_order_relaxed);
+		sink = sink + acc;
+
+		return {name, iterations, elapsed.count() / iterations, (double)(allocsAfter - allocsBefore) / iterations};
+	}
+}
+
+int main(int argc, char** argv) {
+	try {
+		Options opts = parseArgs(argc, argv);
+		srand(opts.seed);
+		if (opts.threads >= 0) WorkerPool::inst().resize(opts.threads);
+		buildWorld(opts);
+
+		auto& eh = EventHandler::inst();
+		auto& hh = HeroesHandler::inst();
+		auto& mh = MissionsHandler::inst();
+		auto& cityMap = CityMap::inst();
+		std::mt19937 rng(opts.seed);
+
+		std::vector<Hero*> heroes;
+		for (HeroId id : hh.roster) heroes.push_back(&hh[id]);
+		std::vector<Mission*> missions;
+		for (auto& ms : mh.missions) if (!ms->assignedHeroes.empty()) missions.push_back(ms.get());
+		std::sort(BEGEND(missions), [](Mission* a, Mission* b) { return a->name < b->name; });
+
+		struct EffectCall { std::shared_ptr<Effect> effect; EventData data; };
+		std::vector<EffectCall> effectCalls;
+		for (auto* ms : missions) for (HeroId id : ms->assignedHeroes) for (auto& power : hh[id].powers) for (auto& effect : power.effects) {
+			if (dynamic_cast<AttrBonusEffect*>(effect.get())) effectCalls.push_back({effect, MissionStartData{ms->id, &ms->assignedSlots}});
+		}
+
+		std::uniform_real_distribution<float> px(0.0f, screenSize.x), py(0.0f, screenSize.y);
+		std::uniform_int_distribution<int> node(0, (int)cityMap.points.size() - 1);
+		std::vector<raylib::Vector2> points(1024);
+		for (auto& p : points) p = raylib::Vector2{px(rng), py(rng)};
+		std::vector<std::pair<int, int>> routes(1024);
+		for (auto& r : routes) r = {node(rng), node(rng)};
+
+		size_t nh = heroes.size(), nm = missions.size(), ne = effectCalls.size();
+		std::vector<std::pair<std::string, std::function<long long(long)>>> benchmarks{
+			{"EventHandler::call/HeroCalcAttr", [&](long i) {
+				Hero& h = *heroes[i % nh];
+				AttrMap<int> attrs;
+				eh.call(Event::HeroCalcAttr, HeroCalcAttrData{h.id, &attrs}, {&h.id, 1});
+				return (long long)attrs[Attribute::COMBAT];
+			}},
+			{"EventHandler::emit<HeroCalcAttr>", [&](long i) {
+				Hero& h = *heroes[i % nh];
+				AttrMap<int> attrs;
+				eh.emit<Event::HeroCalcAttr>({&h.id, 1}, h.id, &attrs);
+				return (long long)attrs[Attribute::COMBAT];
+			}},
+			{"EventHandler::emit<MissionStart>", [&](long i) {
+				Mission& ms = *missions[i % nm];
+				eh.emit<Event::MissionStart>(ms.assignedHeroes, ms.id, &ms.assignedSlots);
+				return 0LL;
+			}},
+			{"Hero::attributes/recalc", [&](long i) {
+				Hero& h = *heroes[i % nh];
+				h.invalidateAttributes();
+				return (long long)h.attributes()[Attribute::VIGOR];
+			}},
+			{"Hero::attributes/memo", [&](long i) {
+				return (long long)heroes[i % nh]->attributes()[Attribute::VIGOR];
+			}},
+			{"Mission::getTotalAttributes", [&](long i) {
+				return (long long)missions[i % nm]->getTotalAttributes()[Attribute::MOBILITY];
+			}},
+			{"Mission::getSuccessChance", [&](long i) {
+				return (long long)missions[i % nm]->getSuccessChance();
+			}},
+			{"AttrBonusEffect::onEvent", [&](long i) {
+				auto& [effect, data] = effectCalls[i % ne];
+				effect->onEvent(Event::MissionStart, data);
+				return 0LL;
+			}},
+			{"CityMap::closestPoint", [&](long i) {
+				return (long long)cityMap.closestPoint(points[i % points.size()]);
+			}},
+			{"CityMap::shortestPath", [&](long i) {
+				auto [src, dest] = routes[i % routes.size()];
+				return (long long)cityMap.shortestPath(src, dest);
+			}},
+			// Steady population of timers spread over the next minute, one scheduled and one tick advanced per op
+			{"TimerWheel::advance", [&, delay = std::uniform_real_distribution<float>(0.0f, 60.0f)](long) mutable {
+				auto& wheel = TimerWheel::inst();
+				wheel.schedule(delay(rng), []{ sink = sink + 1; });
+				wheel.advance(1.0f / 60.0f);
+				return (long long)wheel.size();
+			}},
+			// Activation draw from a 100k mission catalog weighted by difficulty, the pick goes back in so the size holds
+			{"WeightedSet::pick", [&, catalog = WeightedSet<MissionId>{}, unit = std::uniform_real_distribution<double>(0.0, 1.0)](long) mutable {
+				if (catalog.empty()) for (uint32_t i = 0; i < 100000; i++) catalog.insert(MissionId{i}, 1 + i % 5);
+				MissionId id = catalog.pick(unit(rng));
+				double weight = catalog.weight(id);
+				catalog.erase(id);
+				catalog.insert(id, weight);
+				return (long long)id.index;
+			}},
+			// Follow-up missions queued a few seconds out over 10k pending ones, the earliest is popped so the size holds
+			{"Schedule::push/pop", [&, queue = Schedule<MissionId>{}, delay = std::uniform_real_distribution<double>(0.0, 60.0), now = 0.0](long i) mutable {
+				if (queue.empty()) for (uint32_t k = 0; k < 10000; k++) queue.push(delay(rng), MissionId{k});
+				now = queue.nextTime();
+				queue.pop();
+				queue.push(now + delay(rng), MissionId{(uint32_t)i});
+				return (long long)queue.size();
+			}},
+			// Full plan over every waiting mission and its heroes, capped by moves so runs compare
+			{"Dispatcher::plan", [&](long) {
+				auto& dispatcher = Dispatcher::inst();
+				dispatcher.options.budget = 0.0f;
+				dispatcher.options.moves = 2000;
+				return (long long)dispatcher.plan().suggestions.size();
+			}},
+			// 10k lifecycles of one mission with its team, what the planning screen runs on every change
+			{"OutcomeSimulator::simulate/10k", [&](long i) {
+				Mission& ms = *missions[i % nm];
+				return (long long)(OutcomeSimulator::simulate(ms.id, ms.assignedSlots).success * 100);
+			}},
+			// Best 10 teams of 4 out of the whole roster for one mission
+			{"TeamScorer::best/64", [&, scorer = TeamScorer{}](long i) mutable {
+				if (!scorer.size()) scorer.pack(hh.roster);
+				return (long long)scorer.best(missions[i % nm]->requiredAttributes, 4, 10).front().score;
+			}},
+			// Same with requirements no team meets, so the top teams differ on every attribute and little is cut
+			{"TeamScorer::best/64/hard", [&, scorer = TeamScorer{}](long i) mutable {
+				if (!scorer.size()) scorer.pack(hh.roster);
+				AttrMap<int> required = missions[i % nm]->requiredAttributes;
+				for (auto& [attr, value] : required) value *= 4;
+				return (long long)scorer.best(required, 4, 10).front().score;
+			}},
+			// 10k explicit teams of 4 scored in one batch
+			{"TeamScorer::score/10k", [&, scorer = TeamScorer{}, teams = std::vector<int>{}, scores = std::vector<int>{}](long i) mutable {
+				if (!scorer.size()) {
+					scorer.pack(hh.roster);
+					std::uniform_int_distribution<int> member(0, (int)nh - 1);
+					for (int k = 0; k < 40000; k++) teams.push_back(member(rng));
+				}
+				scorer.score(missions[i % nm]->requiredAttributes, teams, 4, scores);
+				return (long long)scores[i % scores.size()];
+			}},
+			// Top 3 fits for one mission out of a 4096 hero roster
+			{"HeroIndex::best/4096", [&, index = HeroIndex{}, value = std::uniform_int_distribution<int>(1, 12)](long i) mutable {
+				if (index.empty()) for (uint32_t k = 0; k < 4096; k++) {
+					AttrMap<int> values;
+					for (auto& [attr, v] : values) v = value(rng);
+					index.set(HeroId{k}, values);
+				}
+				return (long long)index.best(missions[i % nm]->requiredAttributes, 3).front().score;
+			}},
+			// A hero of that roster changing attributes, what a level up or a wound costs the index
+			{"HeroIndex::set/4096", [&, index = HeroIndex{}, value = std::uniform_int_distribution<int>(1, 12), values = AttrMap<int>{}](long i) mutable {
+				if (index.empty()) for (uint32_t k = 0; k < 4096; k++) {
+					for (auto& [attr, v] : values) v = value(rng);
+					index.set(HeroId{k}, values);
+				}
+				for (auto& [attr, v] : values) v = value(rng);
+				index.set(HeroId{(uint32_t)(i % 4096)}, values);
+				return (long long)index.size();
+			}},
+			// One tick over the whole roster, teams are sent out on the first call so part of it is travelling
+			{"HeroesHandler::update", [&, dispatched = false](long) mutable {
+				if (!dispatched) {
+					for (auto* ms : missions) {
+						ms->status = Mission::SELECTED;
+						ms->changeStatus(Mission::TRAVELLING);
+					}
+					dispatched = true;
+				}
+				hh.update(1.0f / 60.0f);
+				return (long long)hh.roster.size();
+			}},
+		};
+
+		json baseline;
+		if (!opts.compare.empty()) baseline = Utils::readJsonFile(opts.compare).at("benchmarks");
+
+		json output{
+			{"config", {{"heroes", opts.heroes}, {"missions", opts.missions}, {"iterations", opts.iterations}, {"seed", opts.seed}, {"threads", WorkerPool::inst().threads()}, {"effects", ne}}},
+			{"benchmarks", json::object()},
+		};
+		Utils::println("{} heroes, {} missions with teams, {} effects", nh, nm, ne);
+		for (auto& [name, op] : benchmarks) {
+			if (!opts.filter.empty() && name.find(opts.filter) == std::string::npos) continue;
+			if ((name.starts_with("Mission") && !nm) || (name.starts_with("AttrBonusEffect") && !ne)) continue;
+			Result res = run(name, opts.iterations, op);
+			output["benchmarks"][name] = {{"ns_per_op", res.nsPerOp}, {"allocs_per_op", res.allocsPerOp}, {"ops", res.ops}};
+
+			std::string line = std::format("{:<36} {:>12.1f} ns/op {:>10.2f} allocs/op", name, res.nsPerOp, res.allocsPerOp);
+			if (baseline.contains(name)) {
+				double baseNs = baseline[name].at("ns_per_op").get<double>();
+				double baseAllocs = baseline[name].at("allocs_per_op").get<double>();
+				line += std::format("   (baseline {:.1f} ns/op, {:+.1f}%, {:.2f} allocs/op)", baseNs, 100.0 * (res.nsPerOp - baseNs) / baseNs, baseAllocs);
+			}
+			Utils::println(line);
+		}
+
+		std::ofstream file{opts.out};
+		if (!file) throw std::runtime_error(std::format("Could not open '{}' for writing", opts.out));
+		file << output.dump(1, '\t') << '\n';
+		Utils::println("Results written to {}", opts.out);
+	} catch (const std::exception& e) {
+		std::cerr << e.what() << std::endl;
+		return 1;
+	}
+
+	return 0;
+}
@@ -3,7 +3,8 @@
 #include <string>
 #include <stdexcept>
 #include <string_view>
-#include <unordered_map>
+
+#include <EnumMap.hpp>
 
 #include <nlohmann/json.hpp>
 #include <nlohmann/detail/macro_scope.hpp>
@@ -89,20 +90,26 @@ struct AttrHash {
 	}
 };
 
+// Five attributes padded to 8 lanes, the elementwise operators loop over every lane so they compile down to vector ops
 template <typename ValueType>
-class AttrMap : public std::unordered_map<Attribute::Value, ValueType, AttrHash> {
+class AttrMap : public EnumMap<Attribute::Value, ValueType, Attribute::COUNT, 8> {
+	using Base = EnumMap<Attribute::Value, ValueType, Attribute::COUNT, 8>;
+	using Base::data;
+	using Base::lanes;
 public:
-	AttrMap() { for (auto attr : Attribute::Values) (*this)[attr] = ValueType{}; }
+	AttrMap() = default;
 
+	using Base::operator[];
 	ValueType& operator[](int idx) {
 		if (idx < 0 || idx >= Attribute::COUNT) throw std::out_of_range("Invalid Attribute index");
-		return std::unordered_map<Attribute::Value, ValueType, AttrHash>::operator[](Attribute::Values[idx]);
+		return data[idx];
 	}
-
 	const ValueType& operator[](int idx) const {
 		if (idx < 0 || idx >= Attribute::COUNT) throw std::out_of_range("Invalid Attribute index");
-		return this->at(Attribute::Values[idx]);
+		return data[idx];
 	}
+	ValueType& at(Attribute::Value attr) { return (*this)[(int)attr]; }
+	const ValueType& at(Attribute::Value attr) const { return (*this)[(int)attr]; }
 
 	AttrMap<ValueType> operator+(const AttrMap<ValueType>& other) const {
 		AttrMap<ValueType> result = *this;
@@ -110,7 +117,7 @@ public:
 		return result;
 	}
 	AttrMap<ValueType>& operator+=(const AttrMap<ValueType>& other) {
-		for (Attribute attr : Attribute::Values) (*this)[attr] += other[attr];
+		for (size_t i = 0; i < lanes; i++) data[i] += other.data[i];
 		return *this;
 	}
 
@@ -120,9 +127,30 @@ public:
 		return result;
 	}
 	AttrMap<ValueType>& operator-=(const AttrMap<ValueType>& other) {
-		for (Attribute attr : Attribute::Values) (*this)[attr] -= other[attr];
+		for (size_t i = 0; i < lanes; i++) data[i] -= other.data[i];
 		return *this;
 	}
+
+	AttrMap<ValueType> min(const AttrMap<ValueType>& other) const {
+		AttrMap<ValueType> result;
+		for (size_t i = 0; i < lanes; i++) result.data[i] = data[i] < other.data[i] ? data[i] : other.data[i];
+		return result;
+	}
+	// Padding lanes get clamped too, sum() skips them so a nonzero lower bound does not leak into totals
+	AttrMap<ValueType> clamp(const ValueType& lo, const ValueType& hi) const {
+		AttrMap<ValueType> result;
+		for (size_t i = 0; i < lanes; i++) result.data[i] = data[i] < lo ? lo : (hi < data[i] ? hi : data[i]);
+		return result;
+	}
+	ValueType sum() const {
+		ValueType total{};
+		for (size_t i = 0; i < Attribute::COUNT; i++) total += data[i];
+		return total;
+	}
+	bool operator==(const AttrMap<ValueType>& other) const {
+		for (size_t i = 0; i < Attribute::COUNT; i++) if (!(data[i] == other.data[i])) return false;
+		return true;
+	}
 };
 
 namespace Utils { std::string toLower(std::string); }
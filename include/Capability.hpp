@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <stdexcept>
+
+#include <Attribute.hpp>
+
+// What a hero can do as bits, missions keep the union of their team so a check is a single AND.
+// TEAM_ bits are granted to everyone on the hero's mission.
+class Capability {
+public:
+	using Mask = uint32_t;
+	enum Value : Mask {
+		NONE        = 0,
+		FLIGHT      = 1u << 0,
+		TEAM_FLIGHT = 1u << 1,
+	};
+	inline static constexpr Value Values[] = { FLIGHT, TEAM_FLIGHT };
+
+	static constexpr std::string_view toString(Value v) {
+		switch (v) {
+			case FLIGHT: return "flight";
+			case TEAM_FLIGHT: return "team-flight";
+			default: return "none";
+		}
+	}
+	static constexpr Value fromString(std::string_view s) {
+		for (Value v : Values) if (AttributeUtils::equals(s, toString(v))) return v;
+		throw std::invalid_argument("Unknown capability: " + std::string(s));
+	}
+};
@@ -1,9 +1,30 @@
 #pragma once
 
+#include <cstdint>
 #include <vector>
 #include <unordered_set>
 #include <raylib-cpp.hpp>
 
+// Polyline with the cumulative arc length at each point, walked by distance travelled
+struct Route {
+	std::vector<raylib::Vector2> points;
+	std::vector<float> arc;
+
+	void clear() { points.clear(); arc.clear(); }
+	void add(raylib::Vector2 p) {
+		arc.push_back(points.empty() ? 0.0f : arc.back() + points.back().Distance(p));
+		points.push_back(p);
+	}
+	float length() const { return arc.empty() ? 0.0f : arc.back(); }
+	// The cursor only moves forward, so walking a route is O(1) amortized per sample
+	raylib::Vector2 sample(float distance, uint32_t& cursor) const {
+		if (distance >= length()) return points.back();
+		while (cursor + 2 < arc.size() && arc[cursor + 1] <= distance) cursor++;
+		float segment = arc[cursor + 1] - arc[cursor];
+		return points[cursor].Lerp(points[cursor + 1], segment > 0.0f ? (distance - arc[cursor]) / segment : 1.0f);
+	}
+};
+
 class CityMap {
 private:
 	CityMap(std::string fileName="resources/data/map-graph.txt");
@@ -13,6 +34,8 @@ public:
 	std::vector<raylib::Vector2> points;
 	std::vector<std::unordered_set<int>> roads;
 	raylib::Vector2 sourceSize;
+	// The base heroes leave from and return to, the last point of the graph file
+	int base = 0;
 
 	void load(std::string fileName);
 	void renderUI();
@@ -21,4 +44,6 @@ public:
 	int closestPoint(raylib::Vector2 p);
 	int shortestPath(raylib::Vector2 src, raylib::Vector2 dest);
 	int shortestPath(int src, int dest);
+	// Whole trip from a position through the first node, then along the roads (or straight, when flying) to the destination
+	void planTrip(Route& route, raylib::Vector2 from, int first, raylib::Vector2 to, bool flying);
 };
@@ -0,0 +1,155 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <stdexcept>
+#include <unordered_map>
+#include <vector>
+
+// Set stored contiguously with an index map next to it: insert, erase and contains are O(1) and any element
+// can be reached by position, so picking one at random doesn't walk the set.
+// Erasing moves the last element into the hole, iteration order is not stable across erases.
+template<typename T, typename Hash = std::hash<T>>
+class DenseSet {
+protected:
+	std::vector<T> items;
+	std::unordered_map<T, uint32_t, Hash> index;
+public:
+	using value_type = T;
+	using const_iterator = typename std::vector<T>::const_iterator;
+
+	bool insert(const T& value) {
+		if (!index.try_emplace(value, (uint32_t)items.size()).second) return false;
+		items.push_back(value);
+		return true;
+	}
+	bool erase(const T& value) {
+		auto it = index.find(value);
+		if (it == index.end()) return false;
+		uint32_t pos = it->second;
+		index.erase(it);
+		if (pos + 1 != items.size()) {
+			items[pos] = items.back();
+			index[items[pos]] = pos;
+		}
+		items.pop_back();
+		return true;
+	}
+	void clear() { items.clear(); index.clear(); }
+	void reserve(size_t n) { items.reserve(n); index.reserve(n); }
+
+	bool contains(const T& value) const { return index.contains(value); }
+	size_t count(const T& value) const { return index.count(value); }
+	size_t size() const { return items.size(); }
+	bool empty() const { return items.empty(); }
+	// Position of value, size() when it isn't in the set
+	size_t find(const T& value) const {
+		auto it = index.find(value);
+		return it == index.end() ? items.size() : it->second;
+	}
+
+	const T& operator[](size_t pos) const { return items[pos]; }
+	const_iterator begin() const { return items.begin(); }
+	const_iterator end() const { return items.end(); }
+};
+
+// DenseSet with a weight per element, kept in a Fenwick tree over the positions so updates and weighted picks are O(log n).
+// Swap-removal only touches the two positions involved. The base is private, changes that skip the tree can't reach it.
+template<typename T, typename Hash = std::hash<T>>
+class WeightedSet : private DenseSet<T, Hash> {
+private:
+	using Base = DenseSet<T, Hash>;
+	std::vector<double> weights;
+	// 1-based, tree[i] sums the weights of positions (i - lowbit(i), i]
+	std::vector<double> tree{0.0};
+
+	static size_t lowbit(size_t i) { return i & (~i + 1); }
+	void add(size_t pos, double delta) { for (size_t i = pos + 1; i < tree.size(); i += lowbit(i)) tree[i] += delta; }
+	double prefix(size_t n) const {
+		double sum = 0.0;
+		for (size_t i = n; i > 0; i -= lowbit(i)) sum += tree[i];
+		return sum;
+	}
+public:
+	using typename Base::value_type;
+	using typename Base::const_iterator;
+	using Base::contains;
+	using Base::count;
+	using Base::size;
+	using Base::empty;
+	using Base::find;
+	using Base::operator[];
+	using Base::begin;
+	using Base::end;
+
+	bool insert(const T& value, double weight = 1.0) {
+		if (weight < 0.0) throw std::invalid_argument("WeightedSet weights cannot be negative");
+		if (!Base::insert(value)) return false;
+		size_t i = tree.size();
+		// The new node covers the positions below it in its range too
+		tree.push_back(prefix(i - 1) - prefix(i - lowbit(i)) + weight);
+		weights.push_back(weight);
+		return true;
+	}
+	bool erase(const T& value) {
+		size_t pos = Base::find(value), last = this->items.size() - 1;
+		if (pos == this->items.size()) return false;
+		add(pos, weights[last] - weights[pos]);
+		weights[pos] = weights[last];
+		weights.pop_back();
+		tree.pop_back();
+		Base::erase(value);
+		return true;
+	}
+	void clear() {
+		Base::clear();
+		weights.clear();
+		tree.assign(1, 0.0);
+	}
+	void reserve(size_t n) {
+		Base::reserve(n);
+		weights.reserve(n);
+		tree.reserve(n + 1);
+	}
+
+	double weight(const T& value) const {
+		size_t pos = Base::find(value);
+		return pos == this->items.size() ? 0.0 : weights[pos];
+	}
+	void setWeight(const T& value, double weight) {
+		if (weight < 0.0) throw std::invalid_argument("WeightedSet weights cannot be negative");
+		size_t pos = Base::find(value);
+		if (pos == this->items.size()) return;
+		add(pos, weight - weights[pos]);
+		weights[pos] = weight;
+	}
+	double total() const { return prefix(this->items.size()); }
+
+	// Element whose cumulative weight range holds u * total(), u in [0, 1). The descent stops at the first position whose
+	// prefix sum is above the target, so zero-weight elements are never picked. Node sums carry rounding from updates,
+	// they are compared with a tolerance well below any weight that matters.
+	const T& pick(double u) const {
+		if (this->items.empty()) throw std::out_of_range("Cannot pick from an empty WeightedSet");
+		double sum = total();
+		if (!(sum > 0.0)) throw std::out_of_range("Cannot pick from a WeightedSet without weight");
+		size_t n = this->items.size(), top = 1;
+		while (top * 2 <= n) top *= 2;
+		double slack = sum * 1e-12;
+		auto descend = [&](double target) {
+			size_t pos = 0;
+			for (size_t step = top; step > 0; step /= 2) {
+				if (pos + step <= n && tree[pos + step] <= target + slack) {
+					pos += step;
+					target -= tree[pos];
+				}
+			}
+			return pos;
+		};
+		size_t pos = descend(std::clamp(u, 0.0, 1.0) * sum);
+		// A target within the slack of the total runs off the end, it belongs to the last element with weight
+		if (pos >= n) pos = descend(sum - 2.0 * slack);
+		return this->items[std::min(pos, n - 1)];
+	}
+};
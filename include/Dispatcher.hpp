@@ -0,0 +1,120 @@
+#pragma once
+
+#include <chrono>
+#include <random>
+#include <vector>
+
+#include <Attribute.hpp>
+#include <EntityId.hpp>
+
+class AttrBonusEffect;
+
+// Suggests teams for every mission waiting on heroes at once, maximising the expected outcome over all of them.
+// plan() takes a snapshot of the missions and heroes, then local search runs from it on the WorkerPool until the budget is spent.
+// step() does the same a slice at a time, so a frame loop can keep the plan fresh without stalling. It only plans again
+// once the open missions or the heroes changed.
+// Suggestions stay valid until the next plan is done, apply() only assigns heroes that are still free.
+class Dispatcher {
+public:
+	struct Options {
+		// Seconds of search, 0 leaves only the move limit
+		float budget = 0.005f;
+		// Seconds of search per step()
+		float slice = 0.001f;
+		// Moves per search, 0 leaves only the budget. With a move limit and no budget the plan is reproducible.
+		long moves = 0;
+		unsigned int seed = 1;
+		// Reward is the mission difficulty, scaled up as the time left to dispatch it runs out: urgency seconds left double it
+		float urgency = 10.0f;
+		// Reward lost per second until the whole team is on site, and per expected wound on dangerous missions
+		float travelCost = 0.01f, woundCost = 0.5f;
+	};
+	struct Suggestion {
+		MissionId mission;
+		// One per slot, invalid ids mark the slots left empty
+		std::vector<HeroId> slots;
+		int chance = 0;
+		float travelTime = 0.0f, value = 0.0f;
+	};
+	struct Plan {
+		std::vector<Suggestion> suggestions;
+		float value = 0.0f;
+		// Moves tried over all searches
+		long moves = 0;
+	};
+private:
+	Dispatcher() = default;
+	Dispatcher(const Dispatcher&) = delete;
+	Dispatcher& operator=(const Dispatcher&) = delete;
+
+	struct TeamBonus {
+		AttrBonusEffect* effect;
+		AttrMap<int> values;
+	};
+	struct Candidate {
+		HeroId id;
+		// Attributes without the bonuses of the current team, those are added back per suggested slot
+		AttrMap<int> base;
+		std::vector<TeamBonus> bonuses;
+		bool flies, teamFlight;
+		float speed;
+	};
+	struct Target {
+		MissionId id;
+		AttrMap<int> required;
+		int requiredTotal, slots, offset;
+		float reward;
+		bool dangerous;
+		// Trip to the mission by road and flying, one entry per candidate
+		std::vector<float> road, air;
+	};
+	// One search: flat slot array over all targets, the slot each candidate holds and the value per target
+	struct State {
+		std::vector<int> slotHero, heroSlot;
+		std::vector<float> values;
+		float total = 0.0f;
+		long moves = 0;
+	};
+	// A search carried over between step() calls
+	struct Run {
+		unsigned int seed;
+		State state, best;
+		std::mt19937 rng;
+		float hottest = 0.0f, spent = 0.0f;
+		bool started = false, done = false;
+	};
+
+	std::vector<Candidate> candidates;
+	std::vector<Target> targets;
+	std::vector<int> slotTarget;
+	std::vector<Run> runs;
+	Plan current;
+	// What the last snapshot was taken from
+	std::vector<MissionId> openMissions;
+	unsigned long heroChanges = 0;
+	bool snapshotted = false;
+
+	// Active missions in PENDING or SELECTED
+	std::vector<MissionId> waiting() const;
+	bool stale() const;
+	void snapshot();
+	float evaluate(const std::vector<int>& slotHero, int target, int* chance = nullptr, float* travel = nullptr) const;
+	void place(State& state, int slot, int hero) const;
+	void greedy(State& state, std::mt19937& rng, bool shuffle) const;
+	void begin();
+	void anneal(Run& run, std::chrono::steady_clock::time_point until) const;
+	void publish();
+public:
+	Options options;
+
+	static Dispatcher& inst();
+
+	const Plan& plan();
+	// Continues the plan in progress for options.slice seconds, or starts one if the last is stale. True when it finished and last() is new.
+	bool step();
+	const Plan& last() const { return current; }
+	// nullptr when the last plan has nothing for the mission
+	const Suggestion* suggestion(MissionId mission) const;
+	// Assigns the suggested team to a mission in PENDING or SELECTED, returns how many heroes were assigned
+	int apply(MissionId mission);
+};
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstdint>
 #include <string>
 #include <vector>
 #include <set>
@@ -11,6 +12,7 @@
 
 #include <Attribute.hpp>
 #include <Event.hpp>
+#include <ListenerHandle.hpp>
 
 class Hero; class Power;
 
@@ -18,10 +20,11 @@ class Effect : public std::enable_shared_from_this<Effect> {
 	static std::shared_ptr<Effect> effect_factory(const std::string& type);
 public:
 	Effect()=default;
-	virtual ~Effect()=default;
+	virtual ~Effect();
 
 	Hero* hero;
 	Power* power;
+	ListenerHandle<Effect> listenerHandle;
 	bool disabled=true;
 	std::array<std::set<int>, 4> slotRestriction;
 
@@ -30,9 +33,13 @@ public:
 	virtual std::set<Event> getEventList() const;
 	virtual bool active() const;
 	virtual bool checkSlotRestriction(const EventData& args);
+	bool checkSlotRestriction(const std::vector<HeroId>* assignedSlots);
 
 	virtual bool onCheck(Event event, const EventData& args);
 	virtual void onEvent(Event event, const EventData& args);
+	// Statically typed entry point used by EventHandler, goes straight to on##NAME / onAny##NAME without building or visiting an EventData
+	template<Event::Type T>
+	void handle(const typename Event::TypeToData<T>::Type& d);
 
 	virtual void to_json(nlohmann::json& j) const;
 	virtual void from_json(const nlohmann::json& j);
@@ -56,10 +63,33 @@ public:
 		DIVIDE,
 		ASSIGN
 	};
+	// Where a compiled operand reads its attributes from, CONSTANT operands hold a fixed attribute or value
+	enum Source : uint8_t {
+		CONSTANT,
+		HERO,
+		MISSION,
+		EXCESS,
+		MISSING
+	};
+	enum Selector : uint8_t {
+		ATTRIBUTE,
+		LOWEST,
+		HIGHEST,
+		RANDOM
+	};
+	struct Operand {
+		Source source = CONSTANT;
+		Selector selector = ATTRIBUTE;
+		Attribute::Value attribute = Attribute::COMBAT;
+		int value = 1;
+	};
 	struct Operation {
 		std::variant<std::string, Attribute> attribute;
 		Operator oper{PLUS};
 		std::variant<int, std::string> value = 1;
+		// Compiled from attribute/value when loaded, strings like "heroLowest" or "excessCharisma" are never parsed again
+		Operand target, operand;
+		void compile();
 	};
 	std::map<Event, std::vector<Operation>> operations;
 	AttrMap<int> bonus;
@@ -73,17 +103,16 @@ public:
 		ALL_LEFT,
 		ALL_RIGHT
 	} appliesTo = SELF;
+	// Heroes whose attributes include this bonus, kept up to date by Hero::updateAttrSources
+	std::vector<Hero*> attrTargets;
 
 	virtual std::set<Event> getEventList() const override;
 
-	virtual void onEvent(Event event, const EventData& args) override;
-	virtual void onHeroCalcAttr(Event event, const HeroCalcAttrData&) override;
-	virtual void onAnyHeroCalcAttr(Event event, const HeroCalcAttrData&) override;
 	virtual void onMissionStart(Event event, const MissionStartData&) override;
 	virtual void onMissionSuccess(Event event, const MissionSuccessData&) override;
 	virtual void onMissionFailure(Event event, const MissionFailureData&) override;
 
-	void onMission(const std::vector<std::string>& assignedSlots);
+	void applyOperations(Event event, MissionId mission, const std::vector<HeroId>* assignedSlots);
 	bool applies(int mySlot, int otherSlot);
 
 	virtual void to_json(nlohmann::json& j) const override;
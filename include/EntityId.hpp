@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <limits>
+
+#include <nlohmann/json.hpp>
+
+class Hero; class Mission;
+
+// Interned key into a handler's dense storage, assigned once when the entity is loaded and stable for its lifetime.
+// Names are only resolved to ids at the edges (JSON, UI), everything else passes ids around.
+template<typename T>
+struct EntityId {
+	static constexpr uint32_t INVALID = std::numeric_limits<uint32_t>::max();
+	uint32_t index = INVALID;
+
+	bool valid() const { return index != INVALID; }
+	bool operator==(const EntityId&) const = default;
+	auto operator<=>(const EntityId&) const = default;
+};
+
+using HeroId = EntityId<Hero>;
+using MissionId = EntityId<Mission>;
+
+namespace std {
+	template<typename T>
+	struct hash<EntityId<T>> { std::size_t operator()(const EntityId<T>& id) const { return id.index; } };
+}
+
+template<typename T>
+inline void to_json(nlohmann::json& j, const EntityId<T>& id) { j = id.valid() ? nlohmann::json(id.index) : nlohmann::json(nullptr); }
@@ -2,20 +2,26 @@
 
 #include <array>
 #include <cstddef>
+#include <optional>
 #include <type_traits>
 #include <stdexcept>
+#include <utility>
 
-template<typename Enum, typename Value, Enum MaxEnum>
+// Lanes pads the backing array past the last enum value so elementwise loops can run over a vector-friendly width,
+// padding entries stay value-initialized and are never visited by iteration
+template<typename Enum, typename Value, Enum MaxEnum, size_t Lanes = static_cast<size_t>(MaxEnum)>
 class EnumMap {
 public:
-	static constexpr size_t size = static_cast<size_t>(MaxEnum);
-private:
-	std::array<Value, size> data;
+	static constexpr size_t count = static_cast<size_t>(MaxEnum);
+	static constexpr size_t lanes = Lanes;
+	static_assert(lanes >= count, "EnumMap lanes must cover every enum value");
+protected:
+	std::array<Value, lanes> data{};
 public:
 
 	EnumMap() = default;
 	EnumMap(std::initializer_list<Value> init) {
-		if (init.size() != size) throw std::invalid_argument("EnumMap initializer_list must match size");
+		if (init.size() != count) throw std::invalid_argument("EnumMap initializer_list must match size");
 		std::copy(init.begin(), init.end(), data.begin());
 	}
 
@@ -26,42 +32,46 @@ public:
 		return data[static_cast<size_t>(key)];
 	}
 
+	static constexpr size_t size() { return count; }
+
+	constexpr Value* values() { return data.data(); }
+	constexpr const Value* values() const { return data.data(); }
+
 	// --- Iterator support ---
+	// Dereferencing yields an lvalue pair kept inside the iterator, so `for (auto& [key, value] : map)` binds
 	struct iterator {
 		size_t index;
 		EnumMap* map;
+		mutable std::optional<std::pair<Enum, Value&>> current{};
 
 		constexpr iterator& operator++() { ++index; return *this; }
 		constexpr bool operator!=(const iterator& other) const { return index != other.index; }
 
-		constexpr auto operator*() const {
-			return std::pair<Enum, Value&>{
-				static_cast<Enum>(index),
-				map->data[index]
-			};
+		constexpr std::pair<Enum, Value&>& operator*() const {
+			current.emplace(static_cast<Enum>(index), map->data[index]);
+			return *current;
 		}
 	};
 
 	struct const_iterator {
 		size_t index;
 		const EnumMap* map;
+		mutable std::optional<std::pair<Enum, const Value&>> current{};
 
 		constexpr const_iterator& operator++() { ++index; return *this; }
 		constexpr bool operator!=(const const_iterator& other) const { return index != other.index; }
 
-		constexpr auto operator*() const {
-			return std::pair<Enum, const Value&>{
-				static_cast<Enum>(index),
-				map->data[index]
-			};
+		constexpr std::pair<Enum, const Value&>& operator*() const {
+			current.emplace(static_cast<Enum>(index), map->data[index]);
+			return *current;
 		}
 	};
 
 	constexpr iterator begin() { return {0, this}; }
-	constexpr iterator end() { return {size, this}; }
+	constexpr iterator end() { return {count, this}; }
 
 	constexpr const_iterator begin() const { return {0, this}; }
-	constexpr const_iterator end() const { return {size, this}; }
+	constexpr const_iterator end() const { return {count, this}; }
 	constexpr const_iterator cbegin() const { return {0, this}; }
-	constexpr const_iterator cend() const { return {size, this}; }
+	constexpr const_iterator cend() const { return {count, this}; }
 };
@@ -10,6 +10,7 @@
 #include <nlohmann/json.hpp>
 
 #include <Attribute.hpp>
+#include <EntityId.hpp>
 #include <Utils.hpp>
 
 #define BASE_EVENT_LIST(V)                \
@@ -26,10 +27,10 @@
 #define HERO_EVENTS(V) \
 	V(HeroCalcAttr)
 
-struct MissionStartData { std::string name; const std::vector<std::string>* assignedSlots; };
-struct MissionSuccessData { std::string name; const std::vector<std::string>* assignedSlots; };
-struct MissionFailureData { std::string name; const std::vector<std::string>* assignedSlots; };
-struct HeroCalcAttrData { std::string name; AttrMap<int>* attrs; };
+struct MissionStartData { MissionId mission; const std::vector<HeroId>* assignedSlots; };
+struct MissionSuccessData { MissionId mission; const std::vector<HeroId>* assignedSlots; };
+struct MissionFailureData { MissionId mission; const std::vector<HeroId>* assignedSlots; };
+struct HeroCalcAttrData { HeroId hero; AttrMap<int>* attrs; };
 struct GlobalData {};
 
 using EventData = std::variant<
@@ -49,6 +50,7 @@ public:
 		#define AS_ANY_ENUM(NAME, DATA) Any##NAME,
 		BASE_EVENT_LIST(AS_ANY_ENUM)
 		#undef AS_ANY_ENUM
+		COUNT,
 		UNKNOWN = -1
 	};
 private:
@@ -98,7 +100,7 @@ public:
 	#undef AS_ANY_VECTOR
 
 	bool is_base() const { return value > BASE_START && value < ANY_START; }
-	bool is_any() const { return value > ANY_START; }
+	bool is_any() const { return value > ANY_START && value < COUNT; }
 
 	Event to_base() const {
 		if (is_base()) return value;
@@ -164,7 +166,8 @@ inline void from_json(const nlohmann::json& j, Event& inst) { inst = j.get<std::
 inline void to_json(nlohmann::json& j, const EventData& data) {
 	j = nlohmann::json{};
 	std::visit([&](auto&& d) {
-		if constexpr (requires { d.name; }) { j["name"] = nlohmann::json{d.name}; }
+		if constexpr (requires { d.mission; }) { j["mission"] = nlohmann::json{d.mission}; }
+		if constexpr (requires { d.hero; }) { j["hero"] = nlohmann::json{d.hero}; }
 		if constexpr (requires { *d.assignedSlots; }) { if (d.assignedSlots) j["assignedSlots"] = nlohmann::json{*d.assignedSlots}; }
 		if constexpr (requires { *d.attrs; }) { if (d.attrs) j["attrs"] = nlohmann::json{*d.attrs}; }
 	}, data);
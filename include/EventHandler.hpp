@@ -1,52 +1,143 @@
 #pragma once
 
+#include <array>
+#include <limits>
 #include <map>
-#include <set>
-#include <unordered_map>
-#include <unordered_set>
+#include <span>
 #include <variant>
+#include <vector>
 
 #include <nlohmann/json.hpp>
 
 #include <Effect.hpp>
 #include <Event.hpp>
+#include <ListenerHandle.hpp>
 
 #define LISTENER_TYPES(V) \
 	V(Effect)
 
-#define AS_WEAK_PTR(NAME) std::weak_ptr<NAME>,
-using Listener = std::variant< LISTENER_TYPES(AS_WEAK_PTR) std::monostate>;
-#undef AS_WEAK_PTR
+#define AS_HANDLE(NAME) ListenerHandle<NAME>,
+using Listener = std::variant< LISTENER_TYPES(AS_HANDLE) std::monostate>;
+#undef AS_HANDLE
+// Slot map owning the listener pointers, a released slot bumps its generation so every handle to it goes stale.
+// Each slot also remembers where its listener sits in every event's lists, so listing and unlisting don't search them.
 template<typename T>
-using Listeners = std::map<Event, std::set<std::weak_ptr<T>, std::owner_less<std::weak_ptr<T>>>>;
+struct ListenerSlots {
+	static constexpr uint32_t NONE = std::numeric_limits<uint32_t>::max();
+	struct Slot {
+		T* listener = nullptr;
+		uint32_t generation = 0;
+		// Position in ListenerList::items and in its byHero entry per event, NONE while not listening
+		std::array<uint32_t, Event::COUNT> at, heroAt;
+	};
+	std::vector<Slot> slots;
+	std::vector<uint32_t> freeSlots;
+
+	ListenerHandle<T> acquire(T* listener) {
+		uint32_t index;
+		if (freeSlots.empty()) {
+			index = slots.size();
+			slots.emplace_back();
+		} else {
+			index = freeSlots.back();
+			freeSlots.pop_back();
+		}
+		slots[index].listener = listener;
+		slots[index].at.fill(NONE);
+		slots[index].heroAt.fill(NONE);
+		return {index, slots[index].generation};
+	}
+	bool release(ListenerHandle<T> handle) {
+		if (!get(handle)) return false;
+		auto& slot = slots[handle.index];
+		slot.listener = nullptr;
+		slot.generation++;
+		freeSlots.push_back(handle.index);
+		return true;
+	}
+	T* get(ListenerHandle<T> handle) const {
+		if (handle.index >= slots.size()) return nullptr;
+		auto& slot = slots[handle.index];
+		return slot.generation == handle.generation ? slot.listener : nullptr;
+	}
+	// nullptr for stale handles
+	Slot* live(ListenerHandle<T> handle) { return get(handle) ? &slots[handle.index] : nullptr; }
+};
+// Contiguous listeners of a single event type, stale handles are skipped while dispatching and compacted in batch
 template<typename T>
-using toListeners = std::vector<std::pair<Event, std::weak_ptr<T>>>;
+struct ListenerList {
+	std::vector<ListenerHandle<T>> items;
+	// Same listeners grouped by hero, indexed by HeroId, so targeted events skip everyone else
+	std::vector<std::vector<ListenerHandle<T>>> byHero;
+	bool hasStale = false;
+};
+// Indexed directly by Event::Type
+template<typename T>
+using Listeners = std::array<ListenerList<T>, Event::COUNT>;
+template<typename T>
+using toListeners = std::vector<std::pair<Event, ListenerHandle<T>>>;
 
 
 class EventHandler {
 private:
 	EventHandler();
 	#define AS_MAP(NAME) \
+		ListenerSlots<NAME> NAME##Slots; \
 		Listeners<NAME> NAME##Listeners; \
 		toListeners<NAME> NAME##ToListen, NAME##ToUnlisten;
 	LISTENER_TYPES(AS_MAP)
 	#undef AS_MAP
+	// Listener lists are only modified outside of dispatch, nested calls can happen from inside listeners.
+	// Changes requested mid-dispatch are applied once the outermost dispatch returns.
+	int dispatchDepth = 0;
+	bool listenersDirty = false;
+	struct DispatchGuard;
 	void updateListeners();
+	void dispatchData(Event event, const EventData& data, std::span<const HeroId> targetHeroes);
+
+	struct QueuedEvent {
+		Event event;
+		EventData data;
+		std::vector<HeroId> targetHeroes;
+		std::vector<HeroId> assignedSlots;
+	};
+	bool deferred = false;
+	std::vector<QueuedEvent> queue;
+	std::map<std::pair<int, MissionId>, size_t> queuedIndex;
+	void enqueue(Event event, const EventData& data, std::span<const HeroId> targetHeroes);
 public:
 	static EventHandler& inst();
 
 	// If any listener returns false, the event returns false immediatelly, otherwise, returns true
-	bool check(Event event, EventData& data, const std::unordered_set<std::string>& targetHeroes={});
+	bool check(Event event, EventData& data, std::span<const HeroId> targetHeroes={});
 	// Always calls all listeners
-	void call(Event event, const EventData& data, const std::unordered_set<std::string>& targetHeroes={});
+	void call(Event event, const EventData& data, std::span<const HeroId> targetHeroes={});
 
-	// Variadic function to automatically construct the proper EventData type
+	// Deferred mode: mission events passed to call() are queued until flush() instead of dispatched immediately.
+	// A repeated (event, mission) replaces the pending one in place, flush() dispatches in first-emitted order.
+	// HeroCalcAttr and check() always run immediately, their callers need the result.
+	void setDeferred(bool value);
+	bool isDeferred() const { return deferred; }
+	void flush();
+
+	// Variadic function to automatically construct the proper data type, dispatched without going through EventData
 	template <Event::Type T, typename... Args>
-	void emit(const std::unordered_set<std::string>& targetHeroes, Args&&... args) {
+	void emit(std::span<const HeroId> targetHeroes, Args&&... args) {
 		using DataType = typename Event::TypeToData<T>::Type;
 		DataType d{ std::forward<Args>(args)... };
-		call(T, d, targetHeroes);
+		if (deferred && Event(T).is_mission()) enqueue(T, d, targetHeroes);
+		else dispatch<T>(d, targetHeroes);
 	}
+	// Statically typed dispatch, instantiated for every event in EventHandler.cpp
+	template <Event::Type T>
+	void dispatch(const typename Event::TypeToData<T>::Type& data, std::span<const HeroId> targetHeroes={});
+
+	// Listeners get a slot on creation and must release it before being destroyed
+	#define AS_SLOTS(NAME) \
+		ListenerHandle<NAME> acquire(NAME* listener); \
+		void release(ListenerHandle<NAME> handle);
+	LISTENER_TYPES(AS_SLOTS)
+	#undef AS_SLOTS
 
 	void on(Event event, Listener listener);
 	void off(Event event, Listener listener);
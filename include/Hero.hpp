@@ -9,20 +9,24 @@
 #include <unordered_map>
 
 #include <Attribute.hpp>
+#include <Capability.hpp>
+#include <EntityId.hpp>
+#include <TimerWheel.hpp>
 
-class Power;
+class Power; class AttrBonusEffect; struct HeroStore;
 
 class Hero {
 private:
 	AttrMap<int> real_attributes, memo_attributes;
 public:
+	HeroId id;
 	std::string name, nickname{"?"};
 	std::vector<std::string> tags;
 	std::map<std::string, std::string> bio;
 	std::unordered_map<std::string, std::string> img_paths;
 	AttrMap<int> unconfirmed_attributes;
 	std::vector<Power> powers;
-	enum Status {
+	enum Status : uint8_t {
 		ASSIGNED,
 		TRAVELLING,
 		WORKING,
@@ -32,43 +36,82 @@ public:
 		AVAILABLE,
 		UNAVAILABLE,
 		AWAITING_REVIEW
-	} status{AVAILABLE};
+	};
 	enum Health {
 		NORMAL,
 		WOUNDED,
 		DOWNED
 	} health{NORMAL};
-	float travelSpeedMult=1.0f, elapsedTime=0.0f, finishTime=0.0f, restingTime=10.0f;
-	bool flies=false, needsAttrCalc=true;
+	float travelSpeedMult=1.0f, restingTime=10.0f;
+	// Declared in the hero data, "flies" is read as FLIGHT
+	Capability::Mask capabilities=Capability::NONE;
 	int level=1, exp=0, skillPoints=3, expOffset=0;
-	std::string mission;
-	raylib::Vector2 pos{500, 200}, path;
+	MissionId mission;
+	// Pending status timeout, for now only the end of RESTING
+	TimerHandle timer;
 	raylib::Rectangle uiRect{};
+	// Movement and timers live in the handler's HeroStore, these read and write this hero's slot
+	HeroStore* store;
+	Status& status();
+	Status status() const;
+	raylib::Vector2& pos();
+	raylib::Vector2 pos() const;
+	float elapsedTime() const;
+	float& finishTime();
+	float finishTime() const;
 
-	Hero(const nlohmann::json& data);
+	// The id is assigned before loading, effects register their listeners under it while the powers are read
+	Hero(const nlohmann::json& data, HeroId id, HeroStore& store);
 
+	~Hero();
 	Hero(const Hero&) = delete;
 	Hero& operator=(const Hero&) = delete;
-	Hero(Hero&&) noexcept = default;
-	Hero& operator=(Hero&&) noexcept = default;
+	// Effects link heroes by address, a hero stays where it was created
+	Hero(Hero&&) = delete;
+	Hero& operator=(Hero&&) = delete;
+
+	// Attribute dependency graph: the bonuses feeding this hero's attributes, from its own SELF effects and its teammates'.
+	// Anything that changes an input bumps attrVersion, attributes() only recomputes when it moved past memoVersion.
+	std::vector<AttrBonusEffect*> attrSources;
+	unsigned int attrVersion=1, memoVersion=0;
+	// Counts invalidations across all heroes, caches over several heroes can skip their checks while it stands still
+	inline static unsigned long attrInvalidations = 0;
+	void invalidateAttributes();
+	void updateAttrSources();
+	// Attributes without the current team's bonuses, and the bonuses this hero hands to teammates by slot.
+	// Planning tools rebuild a team's attributes from these for slots that are not assigned yet.
+	AttrMap<int> soloAttributes();
+	std::vector<AttrBonusEffect*> teamBonuses() const;
+	void setMission(MissionId msn);
 
-	AttrMap<int> attributes();
+	const AttrMap<int>& attributes();
+	// The computed attributes by reference, with a version that only moves when the values actually change.
+	// Versions come from one counter shared by every hero, so consumers can cache on the version alone.
+	struct AttrSnapshot {
+		const AttrMap<int>& values;
+		unsigned long version;
+	};
+	AttrSnapshot attrSnapshot();
+	inline static unsigned long attrSnapshotCounter = 0;
+	unsigned long attrSnapshotVersion = 0;
 	float travelSpeed();
+	bool has(Capability::Value capability) const { return capabilities & capability; }
 	bool canFly() const;
 	int maxExp() const;
 
-	void update(float deltaTime);
+	void arrive();
+	void rested();
 	void renderUI(raylib::Rectangle rect);
 
 	void changeStatus(Status st, float fnTime=0.0f);
-	void changeStatus(Status st, std::string msn, float fnTime=0.0f);
+	void changeStatus(Status st, MissionId msn, float fnTime=0.0f);
 	void wound();
 	void heal();
 	void addExp(int xp);
 	void levelUp();
 	void applyAttributeChanges();
 	void resetAttributeChanges();
-	bool updatePath();
+	void planRoute();
 
 	bool operator<(const Hero& other) const;
 
@@ -105,3 +148,4 @@ namespace nlohmann {
 }
 
 #include <Power.hpp>
+#include <HeroStore.hpp>
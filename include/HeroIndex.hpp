@@ -0,0 +1,49 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <set>
+#include <utility>
+#include <vector>
+
+#include <Attribute.hpp>
+#include <EntityId.hpp>
+
+// Heroes ordered by each attribute, for "who fits this mission best" without rating the whole roster.
+// A hero's fit is getSuccessChance's formula for the hero alone: the sum over attributes of min(value, required).
+// best() walks the attribute orders from the top in turn and stops once the heroes it hasn't reached can't beat
+// the k it holds, so a query costs a few set steps per hero it looks at and O(log n) per update.
+class HeroIndex {
+public:
+	struct Match {
+		HeroId hero;
+		int score;
+	};
+private:
+	struct Higher {
+		bool operator()(const std::pair<int, uint32_t>& a, const std::pair<int, uint32_t>& b) const { return a.first != b.first ? a.first > b.first : a.second < b.second; }
+	};
+	// Value and hero index, highest value first
+	using Column = std::set<std::pair<int, uint32_t>, Higher>;
+	std::array<Column, Attribute::COUNT> columns;
+	// What each hero was indexed with, by hero index
+	std::vector<AttrMap<int>> values;
+	std::vector<uint8_t> present;
+	size_t count = 0;
+	// Scratch for best(), which isn't reentrant: a flag per hero index, all clear between calls, and the heroes it set
+	mutable std::vector<uint8_t> seen;
+	mutable std::vector<uint32_t> reached;
+public:
+	// Adds the hero or moves it to its new values
+	void set(HeroId hero, const AttrMap<int>& attributes);
+	bool erase(HeroId hero);
+	void clear();
+
+	bool contains(HeroId hero) const { return hero.index < present.size() && present[hero.index]; }
+	size_t size() const { return count; }
+	bool empty() const { return count == 0; }
+
+	// The k best fits, best first. Among equal fits the one reached first wins, the stronger in some required attribute.
+	std::vector<Match> best(const AttrMap<int>& required, size_t k) const;
+};
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <vector>
+
+#include <raylib-cpp.hpp>
+
+#include <CityMap.hpp>
+#include <Hero.hpp>
+#include <TimerWheel.hpp>
+
+// Per-tick hero state as parallel arrays indexed by HeroId, the Hero objects only keep the cold profile data.
+// advance() only touches these arrays, anything that reaches into missions or the map is left for Hero::arrive.
+// Timed states like resting run on the TimerWheel instead, since only holds the sim time the current status began.
+struct HeroStore {
+	std::vector<Hero::Status> status;
+	std::vector<raylib::Vector2> pos;
+	std::vector<double> since;
+	std::vector<float> finishTime, speed;
+	// Trip planned by Hero::planRoute when the hero leaves, walked by distance travelled
+	std::vector<Route> route;
+	std::vector<float> travelled;
+	std::vector<uint32_t> cursor;
+	// Heroes whose status or attributes changed since HeroesHandler::available() last caught up
+	std::vector<uint32_t> touched;
+	std::vector<uint8_t> dirty;
+	// Bumped on every touch, for readers that only need to know whether any hero changed
+	unsigned long changes = 0;
+
+	size_t size() const { return status.size(); }
+	void reset(size_t i) {
+		if (i >= size()) {
+			status.resize(i + 1);
+			pos.resize(i + 1);
+			since.resize(i + 1);
+			finishTime.resize(i + 1);
+			speed.resize(i + 1);
+			route.resize(i + 1);
+			travelled.resize(i + 1);
+			cursor.resize(i + 1);
+		}
+		touch(i);
+		status[i] = Hero::AVAILABLE;
+		pos[i] = raylib::Vector2{500, 200};
+		since[i] = TimerWheel::inst().now();
+		finishTime[i] = speed[i] = travelled[i] = 0.0f;
+		route[i].clear();
+		cursor[i] = 0;
+	}
+	void clear() {
+		status.clear();
+		pos.clear();
+		since.clear();
+		finishTime.clear();
+		speed.clear();
+		route.clear();
+		travelled.clear();
+		cursor.clear();
+		touched.clear();
+		dirty.clear();
+		changes++;
+	}
+	void touch(size_t i) {
+		changes++;
+		if (i >= dirty.size()) dirty.resize(i + 1, 0);
+		if (dirty[i]) return;
+		dirty[i] = 1;
+		touched.push_back((uint32_t)i);
+	}
+
+	bool moving(size_t i) const { return status[i] == Hero::TRAVELLING || status[i] == Hero::RETURNING; }
+	// Moves along the planned route, returns true when the hero reached its end
+	bool advance(size_t i, float deltaTime) {
+		if (!moving(i)) return false;
+		travelled[i] += speed[i] * deltaTime;
+		pos[i] = route[i].sample(travelled[i], cursor[i]);
+		return travelled[i] >= route[i].length();
+	}
+};
+
+inline Hero::Status& Hero::status() { return store->status[id.index]; }
+inline Hero::Status Hero::status() const { return store->status[id.index]; }
+inline raylib::Vector2& Hero::pos() { return store->pos[id.index]; }
+inline raylib::Vector2 Hero::pos() const { return store->pos[id.index]; }
+inline float Hero::elapsedTime() const { return (float)(TimerWheel::inst().now() - store->since[id.index]); }
+inline float& Hero::finishTime() { return store->finishTime[id.index]; }
+inline float Hero::finishTime() const { return store->finishTime[id.index]; }
+inline void Hero::invalidateAttributes() {
+	attrVersion++;
+	attrInvalidations++;
+	store->touch(id.index);
+}
@@ -7,6 +7,9 @@
 #include <unordered_map>
 
 #include <UI.hpp>
+#include <EntityId.hpp>
+#include <HeroStore.hpp>
+#include <HeroIndex.hpp>
 
 class Hero;
 
@@ -15,14 +18,25 @@ private:
 	HeroesHandler();
 	raylib::Rectangle detailsTabButton{895, 166, 30, 32};
 
-	const Hero* get(const std::string& name) const;
-	Hero* get(const std::string& name);
-	const Hero& getRef(const std::string& name) const;
-	Hero& getRef(const std::string& name);
+	const Hero* get(HeroId id) const;
+	Hero* get(HeroId id);
+	const Hero& getRef(HeroId id) const;
+	Hero& getRef(HeroId id);
+	// Flags from the parallel advance, one per roster entry
+	std::vector<uint8_t> due;
+	// Attribute snapshot version last pushed to layoutHeroDetails
+	unsigned long shownAttrVersion = 0;
+	// AVAILABLE heroes that aren't downed, caught up with store.touched on each available()
+	HeroIndex availableIndex;
 public:
-	std::unordered_map<std::string, std::unique_ptr<Hero>> heroes;
-	std::vector<std::string> roster;
-	std::string selected;
+	// Dense storage indexed by HeroId, names are only looked up through ids when loading or from the UI.
+	// heroes holds the profile side of each hero, what changes every tick lives in store.
+	// store comes first, a hero still touches it when destroyed.
+	HeroStore store;
+	std::vector<std::unique_ptr<Hero>> heroes;
+	std::unordered_map<std::string, HeroId> ids;
+	std::vector<HeroId> roster;
+	HeroId selected;
 	Dispatch::UI::Layout layoutHeroDetails{"resources/layouts/hero-details.json"};
 	enum Tab {
 		UPGRADE,
@@ -32,17 +46,30 @@ public:
 
 	static HeroesHandler& inst();
 	void loadHeroes(const std::string& filePath, bool activate=false);
+	// Loads a hero, one with the same name is replaced in place and keeps its id
+	HeroId addHero(const nlohmann::json& data);
+	void clear();
 
+	HeroId id(const std::string& name) const;
+	const Hero& operator[](HeroId id) const;
+	Hero& operator[](HeroId id);
 	const Hero& operator[](const std::string& name) const;
 	Hero& operator[](const std::string& name);
 	Hero* selectedHero();
+	// Index of the heroes free to be sent out, by their attributes without team bonuses
+	const HeroIndex& available();
 
 	bool paused() const;
-	bool isHeroSelected(const std::string& name) const;
+	bool isHeroSelected(HeroId id) const;
 
 	void renderUI();
 	bool handleInput();
-	void update(float deltaTime);
-	void selectHero(const std::string& name);
+	// Walks every travelling hero deltaTime further, arrivals are only flagged so timers due by then can run first
+	void move(float deltaTime);
+	// Applies the flagged arrivals, skipping heroes whose route was replaced since move()
+	void applyArrivals();
+	void update(float deltaTime) { move(deltaTime); applyArrivals(); }
+	float nextArrival();
+	void selectHero(HeroId id);
 	void changeTab(Tab newTab);
 };
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <cstdint>
+#include <limits>
+
+// Index into EventHandler's listener slots, goes stale once the slot is released and its generation bumped
+template<typename T>
+struct ListenerHandle {
+	static constexpr uint32_t INVALID = std::numeric_limits<uint32_t>::max();
+	uint32_t index = INVALID;
+	uint32_t generation = 0;
+
+	bool valid() const { return index != INVALID; }
+	bool operator==(const ListenerHandle&) const = default;
+};
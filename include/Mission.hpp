@@ -13,6 +13,9 @@ class Mission;
 
 #include <raylib-cpp.hpp>
 #include <Attribute.hpp>
+#include <Capability.hpp>
+#include <TimerWheel.hpp>
+#include <EntityId.hpp>
 #include <Hero.hpp>
 #include <UI.hpp>
 
@@ -40,6 +43,24 @@ public:
 class Mission {
 private:
 	raylib::Rectangle btnCancel, btnStart;
+
+	// Team attribute sum and the success chance it gives, adjusted one hero at a time by assignHero/unassignHero.
+	// Each member's values are kept with their snapshot version, reads only redo the members whose version moved
+	// and skip even that while no hero has been invalidated since the last check.
+	struct TeamMember {
+		HeroId hero;
+		unsigned long version;
+		AttrMap<int> values;
+	};
+	std::vector<TeamMember> team;
+	AttrMap<int> teamAttributes{};
+	int teamChance = 0;
+	unsigned long teamChecked = 0;
+	void addToTeam(HeroId hero);
+	void removeFromTeam(HeroId hero);
+	void clearTeam();
+	void refreshTeam();
+	void updateTeamChance();
 public:
 	enum Status {
 		PENDING,
@@ -54,16 +75,27 @@ public:
 		DISRUPTION_MENU
 	} status{PENDING};
 
+	MissionId id;
 	std::string name, type, caller, description, failureMsg="MISSION FAILED", failureMission, successMsg="MISSION COMPLETED", successMission;
 	std::vector<std::string> requirements;
 	std::vector<Disruption> disruptions;
 	raylib::Vector2 position{0.0f, 0.0f};
 	AttrMap<int> requiredAttributes{}, finalAttributes{};
 	int slots, difficulty=1, curDisruption=-1;
+	// Relative odds of being picked when a random mission is activated
+	float weight=1.0f;
 	float failureTime=60.0f, missionDuration=20.0f, failureMissionTime=0.0f, successMissionTime=0.0f, timeElapsed=0.0f;
 	bool dangerous=false, triggered=false, disrupted=false, success=true;
-	std::unordered_set<std::string> assignedHeroes;
-	std::vector<std::string> assignedSlots;
+	std::vector<HeroId> assignedHeroes;
+	// One entry per slot, invalid ids mark the empty ones
+	std::vector<HeroId> assignedSlots;
+	// Union of the assigned heroes' capabilities, kept up to date by assignHero/unassignHero
+	Capability::Mask teamCapabilities=Capability::NONE;
+	// Mission clock: timeElapsed as of clockSince, running at clockRate until the status or the working team changes.
+	// timer fires at whatever the clock runs into next, failure, a disruption, completion or the disruption timeout.
+	double clockSince=0.0;
+	float clockRate=0.0f;
+	TimerHandle timer;
 
 	Mission(const std::string& name, const std::string& type, const std::string& caller, const std::string& description, const std::string& failureMsg, const std::string& failureMission, const std::string& successMsg, const std::string& successMission, const std::vector<std::string>& requirements, raylib::Vector2 pos, const std::unordered_map<std::string,int> &attr, int slots, int difficulty, float failureTime, float missionDuration, float failureMissionTimeool, float successMissionTime, bool dangerous);
 	Mission(const nlohmann::json& data);
@@ -72,12 +104,19 @@ public:
 
 	void validate() const;
 
-	void toggleHero(const std::string& heroName);
-	void assignHero(const std::string& heroName);
-	void unassignHero(const std::string& heroName);
+	bool isAssigned(HeroId hero) const;
+	void toggleHero(HeroId hero);
+	void assignHero(HeroId hero);
+	void unassignHero(HeroId hero);
 
 	void changeStatus(Status newStatus);
-	void update(float deltaTime);
+	float elapsed() const;
+	float disruptionElapsed() const;
+	float nextDisruptionTime() const;
+	void stopClock();
+	void startClock();
+	void updateClock();
+	void expire();
 
 	void renderUI();
 	void handleInput();
@@ -85,11 +124,11 @@ public:
 	void setupLayout(Dispatch::UI::Layout& layout);
 	void updateLayout(Dispatch::UI::Layout& layout, const std::string& changed);
 
-	AttrMap<int> getTotalAttributes() const;
-	int getTotalAttribute(Attribute attr) const;
-	int getSuccessChance() const;
-	bool isSuccessful() const;
-	bool isDisruptionSuccessful() const;
+	const AttrMap<int>& getTotalAttributes();
+	int getTotalAttribute(Attribute attr);
+	int getSuccessChance();
+	bool isSuccessful();
+	bool isDisruptionSuccessful();
 	bool isMenuOpen() const;
 
 	static std::string statusToString(Status st);
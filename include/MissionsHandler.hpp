@@ -1,11 +1,14 @@
 #pragma once
 
 #include <set>
-#include <unordered_set>
 #include <unordered_map>
 #include <map>
 #include <string>
 #include <memory>
+#include <functional>
+#include <DenseSet.hpp>
+#include <Schedule.hpp>
+#include <EntityId.hpp>
 #include <Mission.hpp>
 #include <Hero.hpp>
 
@@ -13,37 +16,63 @@ class MissionsHandler {
 private:
 	MissionsHandler();
 
-	const Mission* get(const std::string& name) const;
-	Mission* get(const std::string& name);
-	const Mission& getRef(const std::string& name) const;
-	Mission& getRef(const std::string& name);
+	const Mission* get(MissionId id) const;
+	Mission* get(MissionId id);
+	const Mission& getRef(MissionId id) const;
+	Mission& getRef(MissionId id);
+	// Starts the clock of a mission that just went active
+	Mission& activated(MissionId id);
+	void spawn();
 public:
 	Dispatch::UI::Layout layoutMissionDetails{"resources/layouts/mission-details.json"};
-	std::unordered_map<std::string, std::unique_ptr<Mission>> missions;
-	std::unordered_set<std::string> trigger, loaded, active, previous;
-	std::string selected;
-	std::vector<std::pair<std::string,float>> mission_queue;
-	float timeToNext = 1.0f;
+	// Dense storage indexed by MissionId, names are only looked up through ids when loading or from the UI
+	std::vector<std::unique_ptr<Mission>> missions;
+	std::unordered_map<std::string, MissionId> ids;
+	DenseSet<MissionId> trigger, active, previous;
+	// Missions activateMission() picks from, weighted by spawnWeight
+	WeightedSet<MissionId> loaded;
+	std::function<double(const Mission&)> spawnWeight = [](const Mission& mission) { return (double)mission.weight; };
+	MissionId selected;
+	// Missions to activate, keyed on the TimerWheel time they are due at
+	Schedule<MissionId> mission_queue;
+	// Missions that reached DONE or MISSED, moved from active to previous on the next update
+	std::vector<MissionId> finished;
+	// Countdown to the next random mission as of spawnSince, it runs slower the more missions are active
+	float timeToNext = 1.0f, spawnRate = 0.0f;
+	double spawnSince = 0.0;
+	TimerHandle spawnTimer;
+	void updateSpawnClock();
 
 	static MissionsHandler& inst();
 
 	void loadMissions(const std::string& file);
+	// Registers a mission, one with the same name is replaced in place and keeps its id
+	MissionId addMission(std::unique_ptr<Mission> mission);
+	void clear();
+	// Recomputes the weights of the loaded missions, after spawnWeight is swapped or what it reads changed
+	void reweight();
 	Mission& activateMission();
+	Mission& activateMission(MissionId id);
 	Mission& activateMission(const std::string& name);
 	Mission& createRandomMission(int difficulty=-1, int slots=-1);
 
+	MissionId id(const std::string& name) const;
+	const Mission& operator[](MissionId id) const;
+	Mission& operator[](MissionId id);
 	const Mission& operator[](const std::string& name) const;
 	Mission& operator[](const std::string& name);
 	Mission* selectedMission();
 
 	bool paused() const;
 
-	void selectMission(const std::string& name);
+	void selectMission(MissionId id);
 	void unselectMission();
 
-	void addMissionToQueue(const std::string& name, float time);
+	// Activates the mission time seconds from now, the handle can cancel it until then
+	Schedule<MissionId>::Handle addMissionToQueue(const std::string& name, float time);
 
 	void renderUI();
 	void handleInput();
 	void update(float deltaTime);
+	float nextQueued() const;
 };
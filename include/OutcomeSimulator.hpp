@@ -0,0 +1,35 @@
+#pragma once
+
+#include <utility>
+#include <vector>
+
+#include <EntityId.hpp>
+
+// Plays a mission's lifecycle many times over for a team that may not be assigned yet: the disruption it runs into next, the success roll,
+// the wound a dangerous mission deals on failure and the follow-up missions it chains into, which the same team is assumed to take.
+// Outcomes only depend on the team's health along the chain, so they are tabulated once and the trials just walk the table.
+class OutcomeSimulator {
+public:
+	struct Options {
+		long trials = 10000;
+		unsigned int seed = 1;
+		// Missions played per trial, the first one included
+		int depth = 8;
+		// The disruption gets an option the team can pass if there is one, otherwise it is left to time out
+		bool answerDisruptions = true;
+	};
+	struct Result {
+		long trials = 0;
+		// Of the first mission
+		float success = 0.0f, disrupted = 0.0f;
+		// Over the whole chain: any wound at all, and per hero in team order a new wound or being downed at the end
+		float anyWound = 0.0f;
+		std::vector<float> wounded, downed;
+		// Missions the chain went on to, with the share of trials that reached each, most likely first
+		std::vector<std::pair<MissionId, float>> followUps;
+	};
+
+	// team is in slot order, invalid ids are empty slots
+	static Result simulate(MissionId mission, const std::vector<HeroId>& team, const Options& options);
+	static Result simulate(MissionId mission, const std::vector<HeroId>& team) { return simulate(mission, team, Options{}); }
+};
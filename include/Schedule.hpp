@@ -0,0 +1,153 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <queue>
+#include <stdexcept>
+#include <tuple>
+#include <vector>
+
+// Binary min-heap of values keyed on absolute simulation time, push, pop and cancel are O(log n).
+// Entries due at the same time come out in the order they were pushed.
+template<typename T>
+class Schedule {
+public:
+	// Goes stale once its entry is popped or cancelled
+	struct Handle {
+		static constexpr uint32_t INVALID = std::numeric_limits<uint32_t>::max();
+		uint32_t index = INVALID, generation = 0;
+
+		bool valid() const { return index != INVALID; }
+	};
+	struct Entry {
+		double when;
+		T value;
+		Handle handle;
+	};
+private:
+	struct Slot {
+		double when = 0.0;
+		uint64_t seq = 0;
+		T value{};
+		uint32_t generation = 0, pos = 0;
+		bool live = false;
+	};
+	std::vector<Slot> slots;
+	std::vector<uint32_t> freeList;
+	// Slot indices in heap order
+	std::vector<uint32_t> heap;
+	uint64_t pushed = 0;
+
+	bool before(uint32_t a, uint32_t b) const { return std::tie(slots[a].when, slots[a].seq) < std::tie(slots[b].when, slots[b].seq); }
+	void place(size_t pos, uint32_t slot) {
+		heap[pos] = slot;
+		slots[slot].pos = (uint32_t)pos;
+	}
+	void up(size_t pos) {
+		uint32_t slot = heap[pos];
+		while (pos > 0 && before(slot, heap[(pos - 1) / 2])) {
+			place(pos, heap[(pos - 1) / 2]);
+			pos = (pos - 1) / 2;
+		}
+		place(pos, slot);
+	}
+	void down(size_t pos) {
+		uint32_t slot = heap[pos];
+		while (true) {
+			size_t child = 2 * pos + 1;
+			if (child >= heap.size()) break;
+			if (child + 1 < heap.size() && before(heap[child + 1], heap[child])) child++;
+			if (!before(heap[child], slot)) break;
+			place(pos, heap[child]);
+			pos = child;
+		}
+		place(pos, slot);
+	}
+	// Takes the entry at heap position pos out and frees its slot
+	void removeAt(size_t pos) {
+		uint32_t slot = heap[pos];
+		uint32_t last = heap.back();
+		heap.pop_back();
+		if (pos < heap.size()) {
+			place(pos, last);
+			if (pos > 0 && before(last, heap[(pos - 1) / 2])) up(pos);
+			else down(pos);
+		}
+		slots[slot].live = false;
+		slots[slot].generation++;
+		slots[slot].value = T{};
+		freeList.push_back(slot);
+	}
+public:
+	Handle push(double when, T value) {
+		uint32_t slot;
+		if (freeList.empty()) {
+			slot = (uint32_t)slots.size();
+			slots.emplace_back();
+		} else {
+			slot = freeList.back();
+			freeList.pop_back();
+		}
+		Slot& s = slots[slot];
+		s.when = when;
+		s.seq = pushed++;
+		s.value = std::move(value);
+		s.live = true;
+		heap.push_back(slot);
+		up(heap.size() - 1);
+		return {slot, s.generation};
+	}
+	bool pending(Handle handle) const { return handle.valid() && handle.index < slots.size() && slots[handle.index].live && slots[handle.index].generation == handle.generation; }
+	// Safe on stale or empty handles, the handle is reset either way. Returns whether an entry was removed.
+	bool cancel(Handle& handle) {
+		bool removed = pending(handle);
+		if (removed) removeAt(slots[handle.index].pos);
+		handle = {};
+		return removed;
+	}
+
+	bool empty() const { return heap.empty(); }
+	size_t size() const { return heap.size(); }
+	// Time of the earliest entry, infinity when there is none
+	double nextTime() const { return heap.empty() ? std::numeric_limits<double>::infinity() : slots[heap[0]].when; }
+	const T& top() const {
+		if (heap.empty()) throw std::out_of_range("Schedule is empty");
+		return slots[heap[0]].value;
+	}
+	T pop() {
+		if (heap.empty()) throw std::out_of_range("Schedule is empty");
+		T value = std::move(slots[heap[0]].value);
+		removeAt(0);
+		return value;
+	}
+	void clear() {
+		for (uint32_t slot : heap) {
+			slots[slot].live = false;
+			slots[slot].generation++;
+			slots[slot].value = T{};
+			freeList.push_back(slot);
+		}
+		heap.clear();
+	}
+
+	// The earliest n entries in the order they will come out, walks only the part of the heap above them: O(n log n)
+	std::vector<Entry> next(size_t n) const {
+		std::vector<Entry> out;
+		if (heap.empty() || n == 0) return out;
+		out.reserve(std::min(n, heap.size()));
+		auto later = [&](size_t a, size_t b) { return before(heap[b], heap[a]); };
+		std::priority_queue<size_t, std::vector<size_t>, decltype(later)> frontier(later);
+		frontier.push(0);
+		while (!frontier.empty() && out.size() < n) {
+			size_t pos = frontier.top();
+			frontier.pop();
+			const Slot& s = slots[heap[pos]];
+			out.push_back({s.when, s.value, {heap[pos], s.generation}});
+			if (2 * pos + 1 < heap.size()) frontier.push(2 * pos + 1);
+			if (2 * pos + 2 < heap.size()) frontier.push(2 * pos + 2);
+		}
+		return out;
+	}
+};
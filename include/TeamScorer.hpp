@@ -0,0 +1,46 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <vector>
+
+#include <Attribute.hpp>
+#include <EntityId.hpp>
+
+// Scores teams drawn from a packed pool of heroes with Mission::getSuccessChance's formula: the sum over attributes of
+// min(team total, required). The pool is one zero-padded column per attribute, so a team of k heroes is k-1 column adds
+// and the last member is scanned down a column for every team sharing the same first k-1.
+// Bonuses heroes give their teammates are left out, the Dispatcher and OutcomeSimulator account for those.
+// Only the bench drives it for now, the Dispatcher's value also weighs travel and those bonuses.
+class TeamScorer {
+public:
+	static constexpr int MAX_SLOTS = 4;
+	struct Team {
+		// The first size entries are set, in pool order
+		std::array<HeroId, MAX_SLOTS> heroes{};
+		int size = 0;
+		int score = 0, chance = 0;
+	};
+private:
+	std::vector<HeroId> pool;
+	std::vector<int> columns;
+	size_t stride = 0;
+public:
+	// Takes the attributes of the heroes as they are now, HeroCalcAttr effects included and bonuses from a current team removed
+	void pack(const std::vector<HeroId>& heroes);
+	// Every AVAILABLE hero that isn't downed
+	void packAvailable();
+
+	const std::vector<HeroId>& heroes() const { return pool; }
+	size_t size() const { return pool.size(); }
+	const int* column(Attribute::Value attr) const { return columns.data() + attr * stride; }
+
+	// teams holds size pool indices per team back to back, -1 for an empty slot. Writes one score per team to out.
+	void score(const AttrMap<int>& required, const std::vector<int>& teams, int size, std::vector<int>& out) const;
+	// The k best teams of min(slots, pool size) heroes, best first, ties go to the team earlier in pool order.
+	// Adding a hero never lowers a score, so smaller teams are not considered.
+	std::vector<Team> best(const AttrMap<int>& required, int slots, size_t k) const;
+
+	// n choose k, saturating
+	static unsigned long long combinations(size_t n, int k);
+};
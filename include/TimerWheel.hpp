@@ -0,0 +1,69 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <vector>
+
+// Handle to a scheduled timer, it goes stale once the timer fires or is cancelled
+struct TimerHandle {
+	static constexpr uint32_t INVALID = std::numeric_limits<uint32_t>::max();
+	uint32_t index = INVALID, generation = 0;
+
+	bool valid() const { return index != INVALID; }
+};
+
+// Hierarchical timer wheel keyed on simulation time, entities register deadlines and get called back when they pass.
+// advance() only does work for the ticks it crosses and the timers that expire, not for every live timer.
+// Slots bucket deadlines by tick, the deadlines themselves stay exact and callbacks see now() at their deadline.
+class TimerWheel {
+private:
+	TimerWheel() = default;
+	TimerWheel(const TimerWheel&) = delete;
+	TimerWheel& operator=(const TimerWheel&) = delete;
+
+	static constexpr double TICKS_PER_SECOND = 64.0;
+	static constexpr int SLOT_BITS = 6, SLOTS = 1 << SLOT_BITS, LEVELS = 4;
+	// The last bucket holds timers past the outermost level, they are re-bucketed each time it wraps
+	static constexpr uint32_t FAR_BUCKET = LEVELS * SLOTS;
+
+	struct Timer {
+		double deadline = 0.0;
+		uint64_t tick = 0;
+		uint32_t generation = 0, bucket = 0, pos = 0;
+		bool live = false;
+		std::function<void()> callback;
+	};
+	std::vector<Timer> timers;
+	std::vector<uint32_t> freeList;
+	std::array<std::vector<uint32_t>, FAR_BUCKET + 1> buckets;
+	std::vector<uint32_t> moving;
+	std::vector<TimerHandle> firing;
+	double time = 0.0;
+	uint64_t current = 0;
+	size_t count = 0;
+
+	void insert(uint32_t index);
+	void remove(uint32_t index);
+	void release(uint32_t index);
+	void rebucket(uint32_t bucket);
+	void fire(double end);
+public:
+	static TimerWheel& inst();
+
+	double now() const { return time; }
+	size_t size() const { return count; }
+
+	TimerHandle schedule(float delay, std::function<void()> callback);
+	TimerHandle scheduleAt(double deadline, std::function<void()> callback);
+	bool pending(TimerHandle handle) const;
+	double deadline(TimerHandle handle) const;
+	// Earliest deadline of any live timer, infinity when none are
+	double nextDeadline() const;
+	// Safe on stale or empty handles, the handle is reset either way
+	void cancel(TimerHandle& handle);
+
+	void advance(float deltaTime);
+	void clear();
+};
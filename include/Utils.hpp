@@ -31,6 +31,7 @@ namespace Utils {
 	void replaceAll(std::string& target, const std::string& toReplace, const std::string& replacement);
 
 	int randInt(int low, int high);
+	double randDouble(double low, double high);
 	std::vector<int> range(int start, int end, int step=1);
 
 	namespace Detail {
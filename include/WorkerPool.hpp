@@ -0,0 +1,59 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// Fixed set of worker threads that split index ranges into chunks, the calling thread works on chunks too.
+// Jobs must only write to the indices they are given, anything shared is left for the caller to apply afterwards.
+class WorkerPool {
+private:
+	WorkerPool();
+	~WorkerPool();
+	WorkerPool(const WorkerPool&) = delete;
+	WorkerPool& operator=(const WorkerPool&) = delete;
+
+	using Job = void(*)(void* ctx, size_t begin, size_t end);
+
+	std::vector<std::thread> workers;
+	std::mutex mutex;
+	std::condition_variable wake, done;
+	bool stopping = false;
+	unsigned long generation = 0;
+	size_t busy = 0;
+
+	Job job = nullptr;
+	void* ctx = nullptr;
+	size_t count = 0, grain = 0;
+	std::atomic<size_t> next{0};
+	std::exception_ptr error;
+
+	void start(size_t threads);
+	void stop();
+	void work();
+	void loop(unsigned long seen);
+	void run(size_t n, size_t chunk, Job fn, void* context);
+public:
+	static WorkerPool& inst();
+
+	// Extra threads next to the caller, 0 runs everything inline
+	size_t threads() const { return workers.size(); }
+	void resize(size_t threads);
+
+	// Calls fn(begin, end) over [0, n) in chunks of at most grain, returns once every chunk is done.
+	// Ranges that fit in one chunk run inline without waking the workers.
+	template<typename F>
+	void parallelFor(size_t n, size_t chunk, F&& fn) {
+		if (chunk == 0) chunk = 1;
+		if (n <= chunk || workers.empty()) {
+			if (n) fn(size_t{0}, n);
+			return;
+		}
+		run(n, chunk, [](void* context, size_t begin, size_t end) { (*static_cast<std::remove_reference_t<F>*>(context))(begin, end); }, &fn);
+	}
+};
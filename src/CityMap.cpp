@@ -6,7 +6,7 @@
 #include <CityMap.hpp>
 #include <Utils.hpp>
 
-extern raylib::Window window;
+extern raylib::Vector2 screenSize;
 
 CityMap::CityMap(std::string fileName) { load(fileName); }
 
@@ -21,7 +21,7 @@ void CityMap::load(std::string fileName) {
 	std::ifstream file{fileName};
 	int n, m, k;
 	file >> n >> sourceSize.x >> sourceSize.y;
-	raylib::Vector2 scaling{window.GetWidth() / sourceSize.x, window.GetHeight() / sourceSize.y};
+	raylib::Vector2 scaling{screenSize.x / sourceSize.x, screenSize.y / sourceSize.y};
 	points.resize(n);
 	roads.resize(n);
 	for (int i = 0; i < n; i++) {
@@ -36,6 +36,7 @@ void CityMap::load(std::string fileName) {
 			roads[k].insert(i);
 		}
 	}
+	base = n - 1;
 	Utils::println("Loaded {} with {} points", fileName, n);
 }
 void CityMap::renderUI() {
@@ -103,3 +104,17 @@ int CityMap::shortestPath(int src, int dest) {
 
 	return route[{src, dest}];
 }
+void CityMap::planTrip(Route& route, raylib::Vector2 from, int first, raylib::Vector2 to, bool flying) {
+	route.clear();
+	route.add(from);
+	route.add(points[first]);
+	if (!flying) {
+		int dest = closestPoint(to), sz = static_cast<int>(points.size());
+		// Bounded in case the destination is not reachable from the first node
+		for (int node = first, hops = 0; node != dest && hops < sz; hops++) {
+			node = shortestPath(node, dest);
+			route.add(points[node]);
+		}
+	}
+	route.add(to);
+}
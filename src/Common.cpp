@@ -44,10 +44,15 @@ int fontChars[] = {
 
 namespace Dispatch::UI {
 	raylib::Font defaultFont{};
+#ifdef HEADLESS_BUILD
+	// No GL context to upload glyph atlases to, the headless sim never draws text anyway
+	raylib::Font emojiFont{}, symbolsFont{}, fontTitle{}, fontText{};
+#else
 	raylib::Font emojiFont{"resources/fonts/NotoEmoji-Regular.ttf", 32, (int[]){ 0x2694, 0x2713, 0x2714, 0x1F3AF, 0x1F3C3, 0x1F4AC, 0x1F5F8, 0x1F6D1, 0x1F6E1, 0x1F9E0, 0 }, 10};
 	raylib::Font symbolsFont{"resources/fonts/NotoSansSymbols2-Regular.ttf", 32, (int[]){ 0x2605, 0x2713, 0x2714, 0x1F3C3, 0x1F5F8, 0 }, 5};
 	raylib::Font fontTitle{"resources/fonts/NotoSans-Bold.ttf", 32, fontChars, sizeof(fontChars)/sizeof(fontChars[0]) - 1};
 	raylib::Font fontText{"resources/fonts/NotoSans-Regular.ttf", 22, fontChars, sizeof(fontChars)/sizeof(fontChars[0]) - 1};
+#endif
 	raylib::Color bgLgt{244, 225, 203};
 	raylib::Color bgMed{198, 175, 145};
 	raylib::Color bgDrk{114, 100, 86};
@@ -0,0 +1,307 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+
+#include <Utils.hpp>
+#include <Dispatcher.hpp>
+#include <Effect.hpp>
+#include <Hero.hpp>
+#include <HeroesHandler.hpp>
+#include <Mission.hpp>
+#include <MissionsHandler.hpp>
+#include <CityMap.hpp>
+#include <WorkerPool.hpp>
+
+Dispatcher& Dispatcher::inst() {
+	static Dispatcher singleton;
+	return singleton;
+}
+
+std::vector<MissionId> Dispatcher::waiting() const {
+	auto& mh = MissionsHandler::inst();
+	std::vector<MissionId> found;
+	for (MissionId id : mh.active) {
+		auto status = mh[id].status;
+		if (status == Mission::PENDING || status == Mission::SELECTED) found.push_back(id);
+	}
+	return found;
+}
+// Any hero change counts, a status, an assignment, a wound or new attributes
+bool Dispatcher::stale() const {
+	return !snapshotted || HeroesHandler::inst().store.changes != heroChanges || waiting() != openMissions;
+}
+
+// Missions waiting for a team and the heroes that could make one: free ones and those already picked for a waiting mission.
+// Everything the searches read is copied here, the workers only touch the bonus effects to ask which slots they reach.
+void Dispatcher::snapshot() {
+	auto& hh = HeroesHandler::inst();
+	auto& mh = MissionsHandler::inst();
+	auto& cityMap = CityMap::inst();
+	candidates.clear();
+	targets.clear();
+	slotTarget.clear();
+
+	openMissions = waiting();
+	heroChanges = hh.store.changes;
+	snapshotted = true;
+	for (HeroId id : hh.roster) {
+		Hero& hero = hh[id];
+		bool planned = hero.status() == Hero::ASSIGNED && std::find(BEGEND(openMissions), hero.mission) != openMissions.end();
+		if ((hero.status() != Hero::AVAILABLE && !planned) || hero.health == Hero::DOWNED) continue;
+		Candidate candidate{id, hero.soloAttributes(), {}, hero.has(Capability::FLIGHT), hero.has(Capability::TEAM_FLIGHT), hero.travelSpeed()};
+		for (AttrBonusEffect* source : hero.teamBonuses()) candidate.bonuses.push_back({source, source->bonus});
+		candidates.push_back(std::move(candidate));
+	}
+
+	// Every trip goes through the base first, so only the stretch from the base is planned per mission
+	Route route;
+	raylib::Vector2 base = cityMap.points[cityMap.base];
+	std::vector<float> lead;
+	for (auto& candidate : candidates) lead.push_back(hh[candidate.id].pos().Distance(base));
+	auto tripTime = [&](const Candidate& candidate, float distance) { return candidate.speed > 0.0f ? distance / candidate.speed : std::numeric_limits<float>::infinity(); };
+	int offset = 0;
+	for (MissionId id : openMissions) {
+		auto& mission = mh[id];
+		Target target{id, mission.requiredAttributes, mission.requiredAttributes.sum(), mission.slots, offset, 0.0f, mission.dangerous, {}, {}};
+		float left = std::max(mission.failureTime - mission.elapsed(), 1.0f);
+		target.reward = mission.difficulty * (1.0f + options.urgency / left);
+		cityMap.planTrip(route, base, cityMap.base, mission.position, false);
+		float road = route.length(), air = base.Distance(mission.position);
+		for (size_t i = 0; i < candidates.size(); i++) {
+			target.road.push_back(tripTime(candidates[i], lead[i] + road));
+			target.air.push_back(tripTime(candidates[i], lead[i] + air));
+		}
+		slotTarget.insert(slotTarget.end(), mission.slots, (int)targets.size());
+		offset += mission.slots;
+		targets.push_back(std::move(target));
+	}
+}
+
+// Expected reward of a target's team. Heroes are placed in the mission's slots in order, like assignHero does,
+// so the slot-to-slot bonuses are counted on those positions.
+float Dispatcher::evaluate(const std::vector<int>& slotHero, int index, int* chance, float* travel) const {
+	const Target& target = targets[index];
+	int team[4], size = 0;
+	bool teamFlight = false;
+	for (int i = 0; i < target.slots; i++) {
+		int hero = slotHero[target.offset + i];
+		if (hero < 0) continue;
+		team[size++] = hero;
+		teamFlight |= candidates[hero].teamFlight;
+	}
+	if (chance) *chance = 0;
+	if (travel) *travel = 0.0f;
+	if (size == 0) return 0.0f;
+
+	AttrMap<int> total{};
+	float trip = 0.0f;
+	for (int i = 0; i < size; i++) {
+		const Candidate& candidate = candidates[team[i]];
+		total += candidate.base;
+		for (int j = 0; j < size; j++) for (auto& bonus : candidates[team[j]].bonuses) if (bonus.effect->applies(j, i)) total += bonus.values;
+		trip = std::max(trip, candidate.flies || teamFlight ? target.air[team[i]] : target.road[team[i]]);
+	}
+	int odds = target.requiredTotal == 0 ? 100 : total.min(target.required).sum() * 100 / target.requiredTotal;
+	if (chance) *chance = odds;
+	if (travel) *travel = trip;
+	float success = odds / 100.0f;
+	return target.reward * success - (target.dangerous ? options.woundCost * (1.0f - success) : 0.0f) - options.travelCost * trip;
+}
+
+void Dispatcher::place(State& state, int slot, int hero) const {
+	int old = state.slotHero[slot];
+	if (old >= 0) state.heroSlot[old] = -1;
+	if (hero >= 0) state.heroSlot[hero] = slot;
+	state.slotHero[slot] = hero;
+}
+
+// Fills targets from the most rewarding down, each slot with the free hero that adds the most, slots that can't gain stay empty
+void Dispatcher::greedy(State& state, std::mt19937& rng, bool shuffle) const {
+	std::vector<int> order(targets.size());
+	std::iota(BEGEND(order), 0);
+	if (shuffle) std::shuffle(BEGEND(order), rng);
+	else std::stable_sort(BEGEND(order), [&](int a, int b) { return targets[a].reward > targets[b].reward; });
+	for (int index : order) {
+		const Target& target = targets[index];
+		for (int i = 0; i < target.slots; i++) {
+			int slot = target.offset + i, best = -1;
+			float bestValue = state.values[index];
+			for (int hero = 0; hero < (int)candidates.size(); hero++) {
+				if (state.heroSlot[hero] >= 0) continue;
+				state.slotHero[slot] = hero;
+				float value = evaluate(state.slotHero, index);
+				if (value > bestValue) {
+					bestValue = value;
+					best = hero;
+				}
+			}
+			state.slotHero[slot] = -1;
+			if (best < 0) break;
+			place(state, slot, best);
+			state.total += bestValue - state.values[index];
+			state.values[index] = bestValue;
+		}
+	}
+}
+
+// Simulated annealing from a greedy start: a move puts a random hero (or nobody) in a random slot, swapping if the hero held
+// another one. Only the one or two targets touched are re-evaluated. A run stops at until and picks up where it left off,
+// the temperature follows the budget spent over all of its calls.
+void Dispatcher::anneal(Run& run, std::chrono::steady_clock::time_point until) const {
+	using clock = std::chrono::steady_clock;
+	State& state = run.state;
+	if (!run.started) {
+		run.started = true;
+		run.rng.seed(run.seed);
+		state.slotHero.assign(slotTarget.size(), -1);
+		state.heroSlot.assign(candidates.size(), -1);
+		state.values.assign(targets.size(), 0.0f);
+		greedy(state, run.rng, run.seed != options.seed);
+		run.best = state;
+		for (auto& target : targets) run.hottest = std::max(run.hottest, target.reward);
+		run.hottest *= 0.05f;
+	}
+	if (slotTarget.empty() || candidates.empty()) {
+		run.done = true;
+		return;
+	}
+
+	std::uniform_int_distribution<int> pickSlot(0, (int)slotTarget.size() - 1), pickHero(-1, (int)candidates.size() - 1);
+	std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+	auto start = clock::now();
+	bool timed = options.budget > 0.0f;
+	auto budgetEnd = timed ? start + std::chrono::duration_cast<clock::duration>(std::chrono::duration<float>(options.budget - run.spent)) : clock::time_point::max();
+	until = std::min(until, budgetEnd);
+	bool bounded = until != clock::time_point::max();
+	float progress = 0.0f;
+
+	while (options.moves <= 0 || state.moves < options.moves) {
+		if ((state.moves & 255) == 0) {
+			if (bounded) {
+				auto now = clock::now();
+				if (now >= until) {
+					run.done = now >= budgetEnd;
+					break;
+				}
+				float timeProgress = timed ? (run.spent + std::chrono::duration<float>(now - start).count()) / options.budget : 0.0f;
+				progress = options.moves > 0 ? std::max(timeProgress, (float)state.moves / options.moves) : timeProgress;
+			} else progress = (float)state.moves / options.moves;
+		}
+		state.moves++;
+		int slot = pickSlot(run.rng), hero = pickHero(run.rng);
+		int occupant = state.slotHero[slot];
+		if (hero == occupant) continue;
+		int other = hero >= 0 ? state.heroSlot[hero] : -1;
+		int a = slotTarget[slot], b = other >= 0 && slotTarget[other] != a ? slotTarget[other] : -1;
+
+		state.slotHero[slot] = hero;
+		if (other >= 0) state.slotHero[other] = occupant;
+		float valueA = evaluate(state.slotHero, a), valueB = b >= 0 ? evaluate(state.slotHero, b) : 0.0f;
+		float delta = valueA - state.values[a] + (b >= 0 ? valueB - state.values[b] : 0.0f);
+		float temperature = run.hottest * (1.0f - progress);
+		if (delta < 0.0f && (temperature <= 0.0f || unit(run.rng) >= std::exp(delta / temperature))) {
+			state.slotHero[slot] = occupant;
+			if (other >= 0) state.slotHero[other] = hero;
+			continue;
+		}
+		if (hero >= 0) state.heroSlot[hero] = slot;
+		if (occupant >= 0) state.heroSlot[occupant] = other;
+		state.values[a] = valueA;
+		if (b >= 0) state.values[b] = valueB;
+		state.total += delta;
+		if (state.total > run.best.total + 1e-4f) {
+			long moves = state.moves;
+			run.best = state;
+			run.best.moves = moves;
+		}
+	}
+	run.spent += std::chrono::duration<float>(clock::now() - start).count();
+	if (options.moves > 0 && state.moves >= options.moves) run.done = true;
+	run.best.moves = state.moves;
+}
+
+// One independent search per thread, the first starts from the plain greedy fill and the others from shuffled ones
+void Dispatcher::begin() {
+	if (options.budget <= 0.0f && options.moves <= 0) throw std::invalid_argument("Dispatcher needs a time budget or a move limit");
+	snapshot();
+	runs.clear();
+	runs.resize(WorkerPool::inst().threads() + 1);
+	for (size_t i = 0; i < runs.size(); i++) runs[i].seed = options.seed + (unsigned int)i;
+}
+
+void Dispatcher::publish() {
+	auto best = std::max_element(BEGEND(runs), [](const Run& a, const Run& b) { return a.best.total < b.best.total; });
+	current = {};
+	current.value = best->best.total;
+	for (auto& run : runs) current.moves += run.best.moves;
+	for (int index = 0; index < (int)targets.size(); index++) {
+		const Target& target = targets[index];
+		Suggestion suggestion{target.id, {}, 0, 0.0f, 0.0f};
+		suggestion.value = evaluate(best->best.slotHero, index, &suggestion.chance, &suggestion.travelTime);
+		for (int i = 0; i < target.slots; i++) {
+			int hero = best->best.slotHero[target.offset + i];
+			if (hero >= 0) suggestion.slots.push_back(candidates[hero].id);
+		}
+		if (suggestion.slots.empty()) continue;
+		suggestion.slots.resize(target.slots);
+		current.suggestions.push_back(std::move(suggestion));
+	}
+	runs.clear();
+}
+
+const Dispatcher::Plan& Dispatcher::plan() {
+	using clock = std::chrono::steady_clock;
+	begin();
+	auto deadline = options.budget > 0.0f ? clock::now() + std::chrono::duration_cast<clock::duration>(std::chrono::duration<float>(options.budget)) : clock::time_point::max();
+	WorkerPool::inst().parallelFor(runs.size(), 1, [&](size_t first, size_t last) {
+		for (size_t i = first; i < last; i++) anneal(runs[i], deadline);
+	});
+	publish();
+	return current;
+}
+
+bool Dispatcher::step() {
+	using clock = std::chrono::steady_clock;
+	if (options.slice <= 0.0f) throw std::invalid_argument("Dispatcher::step needs a slice of time");
+	if (runs.empty()) {
+		if (!stale()) return false;
+		begin();
+	}
+	auto until = clock::now() + std::chrono::duration_cast<clock::duration>(std::chrono::duration<float>(options.slice));
+	WorkerPool::inst().parallelFor(runs.size(), 1, [&](size_t first, size_t last) {
+		for (size_t i = first; i < last; i++) if (!runs[i].done) anneal(runs[i], until);
+	});
+	if (std::any_of(BEGEND(runs), [](const Run& run) { return !run.done; })) return false;
+	publish();
+	return true;
+}
+
+const Dispatcher::Suggestion* Dispatcher::suggestion(MissionId mission) const {
+	auto it = std::find_if(BEGEND(current.suggestions), [&](const Suggestion& s) { return s.mission == mission; });
+	return it != current.suggestions.end() ? &*it : nullptr;
+}
+
+int Dispatcher::apply(MissionId id) {
+	auto& hh = HeroesHandler::inst();
+	auto& mission = MissionsHandler::inst()[id];
+	const Suggestion* suggested = suggestion(id);
+	if (!suggested || (mission.status != Mission::PENDING && mission.status != Mission::SELECTED)) return 0;
+	auto free = [&](HeroId hero) { return hero.valid() && hh[hero].status() == Hero::AVAILABLE; };
+	auto usable = [&](HeroId hero) { return free(hero) || std::find(BEGEND(mission.assignedHeroes), hero) != mission.assignedHeroes.end(); };
+	// Nothing is let go unless part of the suggestion can still be sent
+	if (std::none_of(BEGEND(suggested->slots), usable)) return 0;
+	// The mission's own picks are let go first, they may be suggested for other slots
+	for (HeroId hero : std::vector<HeroId>(mission.assignedHeroes)) mission.unassignHero(hero);
+
+	if (mission.status == Mission::PENDING) mission.changeStatus(Mission::SELECTED);
+	int assigned = 0;
+	for (HeroId hero : suggested->slots) {
+		if (!free(hero)) continue;
+		mission.assignHero(hero);
+		assigned++;
+	}
+	return assigned;
+}
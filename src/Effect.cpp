@@ -28,25 +28,30 @@ std::shared_ptr<Effect> Effect::effect_factory(const json& data, Hero* h, Power*
 	catch (const std::exception& e) { throw std::runtime_error(std::format("Layout Error: Failed to deserialize effect of type '{}'. {}", type, e.what())); }
 
 	auto& eh = EventHandler::inst();
-	auto weak = effect->weak_from_this();
-	for (Event ev : effect->getEventList()) eh.on(ev, Listener{weak});
+	effect->listenerHandle = eh.acquire(effect.get());
+	for (Event ev : effect->getEventList()) eh.on(ev, Listener{effect->listenerHandle});
 
 	return effect;
 }
+Effect::~Effect() {
+	if (listenerHandle.valid()) EventHandler::inst().release(listenerHandle);
+}
 
 std::set<Event> Effect::getEventList() const { return {}; }
 bool Effect::active() const { return power->unlocked && !disabled; }
 bool Effect::checkSlotRestriction(const EventData& args) {
-	const std::vector<std::string>* assignedSlots = std::visit([](auto& d) -> const std::vector<std::string>* {
+	const std::vector<HeroId>* assignedSlots = std::visit([](auto& d) -> const std::vector<HeroId>* {
 		if constexpr (requires { d.assignedSlots; }) { return d.assignedSlots; }
 		else return nullptr; 
 	}, args);
-
+	return checkSlotRestriction(assignedSlots);
+}
+bool Effect::checkSlotRestriction(const std::vector<HeroId>* assignedSlots) {
 	if (assignedSlots) {
 		const auto& slotsVec = *assignedSlots;
 		size_t slotsCount = slotsVec.size();
 
-		auto it = std::find(slotsVec.begin(), slotsVec.end(), hero->name);
+		auto it = std::find(slotsVec.begin(), slotsVec.end(), hero->id);
 		int slot = (it != slotsVec.end()) ? std::distance(slotsVec.begin(), it) : -1;
 
 		if (slot != -1 && slotsCount > 0 && slotsCount <= slotRestriction.size()) {
@@ -83,6 +88,21 @@ void Effect::onEvent(Event event, const EventData& args) {
 	}, args);
 }
 
+template<Event::Type T>
+void Effect::handle(const typename Event::TypeToData<T>::Type& d) {
+	if (!power->unlocked) return;
+	#define GEN_HANDLE(NAME, DATA) \
+		if constexpr (T == Event::NAME) on##NAME(T, d);         \
+		if constexpr (T == Event::Any##NAME) onAny##NAME(T, d);
+	BASE_EVENT_LIST(GEN_HANDLE)
+	#undef GEN_HANDLE
+}
+#define GEN_HANDLE_INSTANCES(NAME, DATA) \
+	template void Effect::handle<Event::NAME>(const DATA&); \
+	template void Effect::handle<Event::Any##NAME>(const DATA&);
+BASE_EVENT_LIST(GEN_HANDLE_INSTANCES)
+#undef GEN_HANDLE_INSTANCES
+
 #ifndef __INTELLISENSE__
 #define GEN_VIRTUALS(NAME, DATA) \
 	bool Effect::check##NAME(Event, const DATA&) { return true; } \
@@ -96,110 +116,64 @@ BASE_EVENT_LIST(GEN_VIRTUALS)
 // AttrBonusEffect
 std::set<Event> AttrBonusEffect::getEventList() const {
 	auto list = Effect::getEventList();
-	if (appliesTo == SELF) list.insert(Event::HeroCalcAttr);
-	else list.merge(std::set<Event>{Event::AnyHeroCalcAttr, Event::MissionStart, Event::MissionSuccess, Event::MissionFailure});
 	for (auto& [ev, _] : operations) list.insert(ev);
 	return list;
 }
-void AttrBonusEffect::onEvent(Event event, const EventData& args) {
-	Effect::onEvent(event, args);
-	if (event == Event::HeroCalcAttr || event.is_any() || !operations.contains(event)) return;
-	if (!checkSlotRestriction(args)) return;
-
-	auto& ops = operations[event];
-	for (auto& [var, oper, value] : ops) {
-		Attribute attr{Attribute::COMBAT};
-		int val = 1;
-
-		if (std::holds_alternative<Attribute>(var)) attr = std::get<Attribute>(var);
-		if (std::holds_alternative<int>(value)) val = std::get<int>(value);
-
-		if (std::holds_alternative<std::string>(var) || std::holds_alternative<std::string>(value)) {
-			auto& mh = MissionsHandler::inst();
-			auto mission = std::visit([&mh](auto& d) -> Utils::optRef<Mission> {
-				if constexpr (requires { d.assignedSlots; d.name; }) { return mh[d.name]; }
-				else return std::nullopt;
-			}, args);
-
-			AttrMap<int> heroAttrs, requiredAttrs;
-			if (hero) heroAttrs = hero->attributes();
-			if (mission) requiredAttrs = mission->get().requiredAttributes;
-
-			auto getAttr = [&](std::string& s) -> AttrMap<int> {
-				AttrMap<int> result;
-				if (s.starts_with("hero"sv) && hero) {
-					result = heroAttrs;
-					s = s.substr(4);
-				} else if (s.starts_with("mission"sv) && mission) {
-					result = requiredAttrs;
-					s = s.substr(7);
-				} else if (s.starts_with("excess"sv) && hero && mission) {
-					for (Attribute a : Attribute::Values) result[a] = std::max(0, heroAttrs[a] - requiredAttrs[a]);
-					s = s.substr(6);
-				} else if (s.starts_with("missing"sv) && hero && mission) {
-					for (Attribute a : Attribute::Values) result[a] = std::max(0, requiredAttrs[a] - heroAttrs[a]);
-					s = s.substr(7);
-				} else throw std::runtime_error("Unknown or invalid operation source string '" + s + "' for event " + std::string(static_cast<std::string>(event)));
-				return result;
-			};
-
-			if (std::holds_alternative<std::string>(var)) {
-				std::string attrStr = std::get<std::string>(var);
-				auto attrsMap = getAttr(attrStr);
-
-				if (attrStr == "Lowest") {
-					int minVal = std::numeric_limits<int>::max();
-					std::set<Attribute> lowest;
-					for (Attribute a : Attribute::Values) {
-						if (attrsMap[a] < minVal) {
-							minVal = attrsMap[a];
-							lowest.clear();
-							lowest.insert(a);
-						} else if (attrsMap[a] == minVal) {
-							lowest.insert(a);
-						}
-					}
-					attr = Utils::random_element(lowest);
-				} else if (attrStr == "Highest") {
-					int maxVal = 0;
-					std::set<Attribute> highest;
-					for (Attribute a : Attribute::Values) {
-						if (attrsMap[a] > maxVal) {
-							maxVal = attrsMap[a];
-							highest.clear();
-							highest.insert(a);
-						} else if (attrsMap[a] == maxVal) {
-							highest.insert(a);
-						}
-					}
-					attr = Utils::random_element(highest);
-				} else if (attrStr == "Random") {
-					attr = Attribute::Values[Utils::randInt(0, Attribute::COUNT - 1)];
-				} else throw std::runtime_error("Unknown or invalid attribute type string '" + attrStr + "' for event " + std::string(static_cast<std::string>(event)));
-			}
-
-			if (std::holds_alternative<std::string>(value)) {
-				std::string valStr = std::get<std::string>(value);
-				auto attrsMap = getAttr(valStr);
-
-				if (valStr == "Lowest") {
-					int minVal = std::numeric_limits<int>::max();
-					for (Attribute a : Attribute::Values) if (attrsMap[a] < minVal) minVal = attrsMap[a];
-					val = minVal;
-				} else if (valStr == "Highest") {
-					int maxVal = 0;
-					for (Attribute a : Attribute::Values) if (attrsMap[a] > maxVal) maxVal = attrsMap[a];
-					val = maxVal;
-				} else if (valStr == "Random") {
-					attr = Attribute::Values[Utils::randInt(0, Attribute::COUNT - 1)];
-				} else if (Attribute::isValid(valStr)) {
-					Attribute vAttr = Attribute::fromString(valStr);
-					val = attrsMap[vAttr];
-				} else throw std::runtime_error("Unknown or invalid attribute type string '" + valStr + "' for event " + std::string(static_cast<std::string>(event)));
-			}
+void AttrBonusEffect::applyOperations(Event event, MissionId mission, const std::vector<HeroId>* assignedSlots) {
+	auto found = operations.find(event);
+	if (found == operations.end()) return;
+	if (!checkSlotRestriction(assignedSlots)) return;
+
+	// Sources are only looked up if an operation reads them
+	const AttrMap<int>* heroAttrs = nullptr;
+	const AttrMap<int>* requiredAttrs = nullptr;
+	auto read = [&](Source source, Attribute::Value a) {
+		if (source != MISSION && !heroAttrs) heroAttrs = &hero->attributes();
+		if (source != HERO && !requiredAttrs) requiredAttrs = &MissionsHandler::inst()[mission].requiredAttributes;
+		switch (source) {
+			case HERO: return (*heroAttrs)[a];
+			case MISSION: return (*requiredAttrs)[a];
+			case EXCESS: return std::max(0, (*heroAttrs)[a] - (*requiredAttrs)[a]);
+			case MISSING: return std::max(0, (*requiredAttrs)[a] - (*heroAttrs)[a]);
+			default: return 0;
+		}
+	};
+	// Lowest/Highest attribute of a source, ties are broken uniformly at random
+	auto pick = [&](Source source, bool lowest) {
+		Attribute::Value best = Attribute::COMBAT;
+		int bestVal = lowest ? std::numeric_limits<int>::max() : 0, ties = 0;
+		for (Attribute::Value a : Attribute::Values) {
+			int v = read(source, a);
+			if (lowest ? v < bestVal : v > bestVal) {
+				bestVal = v;
+				best = a;
+				ties = 1;
+			} else if (v == bestVal && Utils::randInt(0, ties++) == 0) best = a;
+		}
+		return best;
+	};
+	auto randomAttribute = []() { return Attribute::Values[Utils::randInt(0, Attribute::COUNT - 1)]; };
+	bool changed = false;
+
+	for (auto& op : found->second) {
+		Attribute::Value attr = op.target.attribute;
+		int val = op.operand.value;
+
+		switch (op.target.selector) {
+			case LOWEST: attr = pick(op.target.source, true); break;
+			case HIGHEST: attr = pick(op.target.source, false); break;
+			case RANDOM: attr = randomAttribute(); break;
+			case ATTRIBUTE: break;
+		}
+		if (op.operand.source != CONSTANT) switch (op.operand.selector) {
+			case LOWEST: val = read(op.operand.source, pick(op.operand.source, true)); break;
+			case HIGHEST: val = read(op.operand.source, pick(op.operand.source, false)); break;
+			case RANDOM: attr = randomAttribute(); break;
+			case ATTRIBUTE: val = read(op.operand.source, op.operand.attribute); break;
 		}
 
-		switch (oper) {
+		int before = bonus[attr];
+		switch (op.oper) {
 			case Operator::PLUS:
 				bonus[attr] += val;
 				break;
@@ -217,58 +191,21 @@ void AttrBonusEffect::onEvent(Event event, const EventData& args) {
 				break;
 		}
 		bonus[attr] = std::clamp(bonus[attr], lowerLimit, upperLimit);
+		changed |= bonus[attr] != before;
 	}
-	hero->needsAttrCalc = true;
-}
-void AttrBonusEffect::onHeroCalcAttr(Event event, const HeroCalcAttrData& d) {
-	Effect::onHeroCalcAttr(event, d);
-	(*d.attrs) += bonus;
-}
-void AttrBonusEffect::onAnyHeroCalcAttr(Event event, const HeroCalcAttrData& d) {
-	Effect::onAnyHeroCalcAttr(event, d);
-
-	auto& hh = HeroesHandler::inst();
-	auto& mh = MissionsHandler::inst();
-
-	if (d.name.empty()) return;
-	Hero& myHero = *hero;
-	Hero& dHero = hh[d.name];
-
-	std::string& myMissionName = myHero.mission;
-	std::string& dMissionName = dHero.mission;
-	if (myMissionName.empty() || dMissionName.empty() || myMissionName != dMissionName) return;
-	Mission& mission = mh[myMissionName];
-
-	int mySlot=-1, dSlot=-1;
-	for (int i=0; i<mission.slots; i++) {
-		if (mission.assignedSlots[i] == myHero.name) mySlot = i;
-		if (mission.assignedSlots[i] == d.name) dSlot = i;
-	}
-
-	if (applies(mySlot, dSlot)) (*d.attrs) += bonus;
+	if (changed) for (Hero* target : attrTargets) target->invalidateAttributes();
 }
 void AttrBonusEffect::onMissionStart(Event event, const MissionStartData& d) {
 	Effect::onMissionStart(event, d);
-	onMission(*d.assignedSlots);
+	applyOperations(event, d.mission, d.assignedSlots);
 }
 void AttrBonusEffect::onMissionSuccess(Event event, const MissionSuccessData& d) {
 	Effect::onMissionSuccess(event, d);
-	onMission(*d.assignedSlots);
+	applyOperations(event, d.mission, d.assignedSlots);
 }
 void AttrBonusEffect::onMissionFailure(Event event, const MissionFailureData& d) {
 	Effect::onMissionFailure(event, d);
-	onMission(*d.assignedSlots);
-}
-void AttrBonusEffect::onMission(const std::vector<std::string>& assignedSlots) {
-	auto& hh = HeroesHandler::inst();
-	auto it = std::find_if(BEGEND(assignedSlots), [&](const std::string& heroName) { return hero->name == heroName; });
-	if (it != assignedSlots.end()) {
-		int mySlot = it - assignedSlots.begin();
-		for (int slot=0; slot < (int)assignedSlots.size(); slot++) {
-			auto& heroName = assignedSlots[slot];
-			if (!heroName.empty() && applies(mySlot, slot)) hh[heroName].needsAttrCalc = true;
-		}
-	}
+	applyOperations(event, d.mission, d.assignedSlots);
 }
 bool AttrBonusEffect::applies(int mySlot, int otherSlot) {
 	switch (appliesTo) {
@@ -387,4 +324,40 @@ void from_json(const json& j, AttrBonusEffect::Operation& inst) {
 	if (value.is_number_integer()) inst.value = value.get<int>();
 	else if (value.is_string()) inst.value = value.get<std::string>();
 	else throw std::runtime_error("Invalid format for AttrBonusEffect::Operation value");
+
+	inst.compile();
+}
+
+// Operand strings are a source prefix followed by Lowest, Highest, Random or, for values, an attribute name
+static AttrBonusEffect::Operand compileOperand(const std::string& str, bool isTarget) {
+	static constexpr std::pair<std::string_view, AttrBonusEffect::Source> prefixes[] = {
+		{"hero"sv, AttrBonusEffect::HERO},
+		{"mission"sv, AttrBonusEffect::MISSION},
+		{"excess"sv, AttrBonusEffect::EXCESS},
+		{"missing"sv, AttrBonusEffect::MISSING},
+	};
+	AttrBonusEffect::Operand operand;
+	std::string_view rest;
+	for (auto& [prefix, source] : prefixes) {
+		if (!str.starts_with(prefix)) continue;
+		operand.source = source;
+		rest = std::string_view{str}.substr(prefix.size());
+		break;
+	}
+	if (operand.source == AttrBonusEffect::CONSTANT) throw std::invalid_argument(std::format("Unknown or invalid operation source string '{}'", str));
+
+	if (rest == "Lowest"sv) operand.selector = AttrBonusEffect::LOWEST;
+	else if (rest == "Highest"sv) operand.selector = AttrBonusEffect::HIGHEST;
+	else if (rest == "Random"sv) operand.selector = AttrBonusEffect::RANDOM;
+	else if (!isTarget && Attribute::isValid(rest)) operand.attribute = Attribute::fromString(rest);
+	else throw std::invalid_argument(std::format("Unknown or invalid attribute type string '{}'", str));
+	return operand;
+}
+void AttrBonusEffect::Operation::compile() {
+	target = {};
+	operand = {};
+	if (std::holds_alternative<Attribute>(attribute)) target.attribute = std::get<Attribute>(attribute);
+	else target = compileOperand(std::get<std::string>(attribute), true);
+	if (std::holds_alternative<int>(value)) operand.value = std::get<int>(value);
+	else operand = compileOperand(std::get<std::string>(value), false);
 }
@@ -1,6 +1,8 @@
 #include <algorithm>
+#include <format>
 #include <memory>
 #include <iostream>
+#include <utility>
 
 #include <EventHandler.hpp>
 #include <Effect.hpp>
@@ -14,41 +16,54 @@ EventHandler& EventHandler::inst() {
 	return singleton;
 }
 
-template<typename T, typename CleanupFunc>
-void processListenersCheck(Listeners<T>& container, Event event, EventData& args, const std::unordered_set<std::string>& targetHeroes, bool& result, CleanupFunc cleanup) {
-	if (!result) return;
-	
-	auto it = container.find(event);
-	if (it == container.end()) return;
-
-	for (auto& weak : it->second) {
-		auto shared = weak.lock();
-		if (!shared) {
-			cleanup(event, weak);
-			continue;
-		}
-		if constexpr (requires { { shared->hero } -> std::convertible_to<std::string>; }) {
-			if (!targetHeroes.empty() && !targetHeroes.contains(shared->hero)) continue;
-		} else if constexpr (requires { { shared->hero->name } -> std::convertible_to<std::string>; }) {
-			if (!targetHeroes.empty() && !targetHeroes.contains(shared->hero->name)) continue;
-		} else {
-			static_assert(sizeof(shared) == 0, "T must have a 'hero' string or a 'hero.name' string.");
-		}
-		if (!shared->onCheck(event, args)) {
-			result = false;
-			return;
+struct EventHandler::DispatchGuard {
+	EventHandler& eh;
+	DispatchGuard(EventHandler& handler) : eh(handler) { eh.dispatchDepth++; }
+	~DispatchGuard() { if (--eh.dispatchDepth == 0 && eh.listenersDirty) eh.updateListeners(); }
+};
+
+namespace {
+	bool isValid(Event event) { return event >= 0 && event < Event::COUNT; }
+}
+
+template<typename T>
+HeroId listenerHero(const T& listener) {
+	if constexpr (requires { { listener.hero } -> std::convertible_to<HeroId>; }) return listener.hero;
+	else if constexpr (requires { { listener.hero->id } -> std::convertible_to<HeroId>; }) return listener.hero->id;
+	else static_assert(sizeof(T) == 0, "T must have a 'hero' HeroId or a 'hero->id' HeroId.");
+}
+
+// Broadcasts go through every listener of the event, targeted events only through the targeted heroes' listeners
+template<typename T, typename Func>
+void forEachListener(const ListenerSlots<T>& slots, ListenerList<T>& list, std::span<const HeroId> targetHeroes, Func func) {
+	auto visit = [&](const std::vector<ListenerHandle<T>>& items) {
+		for (auto handle : items) {
+			T* listener = slots.get(handle);
+			if (listener && !func(*listener)) return false;
 		}
+		return true;
+	};
+	if (targetHeroes.empty()) visit(list.items);
+	else for (HeroId hero : targetHeroes) {
+		if (hero.index < list.byHero.size() && !visit(list.byHero[hero.index])) return;
 	}
 }
-bool EventHandler::check(Event event, EventData& args, const std::unordered_set<std::string>& targetHeroes) {
-	updateListeners();
-	bool result = true;
 
-	auto cleanup = [this](Event e, auto&& weak) {  this->off(e, Listener{weak});  };
+template<typename T>
+void processListenersCheck(const ListenerSlots<T>& slots, Listeners<T>& container, Event event, EventData& args, std::span<const HeroId> targetHeroes, bool& result) {
+	if (!result) return;
+	forEachListener(slots, container[event], targetHeroes, [&](T& listener) { return result = listener.onCheck(event, args); });
+}
+bool EventHandler::check(Event event, EventData& args, std::span<const HeroId> targetHeroes) {
+	if (!isValid(event)) return true;
+	bool result = true;
 
-	#define CHECK(NAME) processListenersCheck(NAME##Listeners, event, args, targetHeroes, result, cleanup);
-	LISTENER_TYPES(CHECK)
-	#undef CHECK
+	{
+		DispatchGuard guard{*this};
+		#define CHECK(NAME) processListenersCheck(NAME##Slots, NAME##Listeners, event, args, targetHeroes, result);
+		LISTENER_TYPES(CHECK)
+		#undef CHECK
+	}
 
 	if (!result) return false;
 
@@ -56,65 +71,169 @@ bool EventHandler::check(Event event, EventData& args, const std::unordered_set<
 	return true;
 }
 
-template<typename T, typename CleanupFunc>
-void processListenersCall(Listeners<T>& container, Event event, const EventData& args, const std::unordered_set<std::string>& targetHeroes, CleanupFunc cleanup) {
-	auto it = container.find(event);
-	if (it == container.end()) return;
+template<typename T, Event::Type E>
+void processListenersDispatch(const ListenerSlots<T>& slots, Listeners<T>& container, const typename Event::TypeToData<E>::Type& data, std::span<const HeroId> targetHeroes) {
+	forEachListener(slots, container[E], targetHeroes, [&](T& listener) {
+		listener.template handle<E>(data);
+		return true;
+	});
+}
+template<Event::Type T>
+void EventHandler::dispatch(const typename Event::TypeToData<T>::Type& data, std::span<const HeroId> targetHeroes) {
+	{
+		DispatchGuard guard{*this};
+		#define AS_DISPATCH(NAME) processListenersDispatch<NAME, T>(NAME##Slots, NAME##Listeners, data, targetHeroes);
+		LISTENER_TYPES(AS_DISPATCH)
+		#undef AS_DISPATCH
+	}
 
-	for (auto& weak : it->second) {
-		auto shared = weak.lock();
-		if (!shared) {
-			cleanup(event, weak);
-			continue;
-		}
-		if constexpr (requires { { shared->hero } -> std::convertible_to<std::string>; }) {
-			if (!targetHeroes.empty() && !targetHeroes.contains(shared->hero)) continue;
-		} else if constexpr (requires { { shared->hero->name } -> std::convertible_to<std::string>; }) {
-			if (!targetHeroes.empty() && !targetHeroes.contains(shared->hero->name)) continue;
-		} else {
-			static_assert(sizeof(shared) == 0, "T must have a 'hero' string or a 'hero->name' string.");
-		}
-		shared->onEvent(event, args);
+	if constexpr (T > Event::BASE_START && T < Event::ANY_START) {
+		if (!targetHeroes.empty()) dispatch<static_cast<Event::Type>(T + Event::ANY_START - Event::BASE_START)>(data, {});
+	}
+}
+#define AS_INSTANCES(NAME, DATA) \
+	template void EventHandler::dispatch<Event::NAME>(const DATA&, std::span<const HeroId>); \
+	template void EventHandler::dispatch<Event::Any##NAME>(const DATA&, std::span<const HeroId>);
+BASE_EVENT_LIST(AS_INSTANCES)
+#undef AS_INSTANCES
+
+void EventHandler::call(Event event, const EventData& args, std::span<const HeroId> targetHeroes) {
+	if (!isValid(event)) return;
+	if (deferred && event.is_mission()) enqueue(event, args, targetHeroes);
+	else dispatchData(event, args, targetHeroes);
+}
+// Recovers the static type of a runtime event, data that does not match the event type is ignored
+void EventHandler::dispatchData(Event event, const EventData& args, std::span<const HeroId> targetHeroes) {
+	switch (static_cast<int>(event)) {
+		#define AS_CASE(NAME, DATA) \
+			case Event::NAME:      if (auto d = std::get_if<DATA>(&args)) dispatch<Event::NAME>(*d, targetHeroes); break; \
+			case Event::Any##NAME: if (auto d = std::get_if<DATA>(&args)) dispatch<Event::Any##NAME>(*d, targetHeroes); break;
+		BASE_EVENT_LIST(AS_CASE)
+		#undef AS_CASE
+		default: break;
 	}
 }
-void EventHandler::call(Event event, const EventData& args, const std::unordered_set<std::string>& targetHeroes) {
-	updateListeners();
-
-	auto cleanup = [this](Event e, auto&& weak) {  this->off(e, Listener{weak});  };
-
-	#define AS_CALL(NAME) processListenersCall(NAME##Listeners, event, args, targetHeroes, cleanup);
-	LISTENER_TYPES(AS_CALL)
-	#undef AS_CALL
 
-	if (event.is_base() && !targetHeroes.empty()) call(event.to_any(), args, {});
+void EventHandler::enqueue(Event event, const EventData& args, std::span<const HeroId> targetHeroes) {
+	// The slots vector belongs to the mission and may change before the flush, the queue keeps its own copy
+	const std::vector<HeroId>* slots = nullptr;
+	MissionId mission;
+	std::visit([&](auto& d) {
+		if constexpr (requires { d.assignedSlots; }) slots = d.assignedSlots;
+		if constexpr (requires { d.mission; }) mission = d.mission;
+	}, args);
+
+	QueuedEvent queued{event, args, {BEGEND(targetHeroes)}, slots ? *slots : std::vector<HeroId>{}};
+	auto [it, inserted] = queuedIndex.try_emplace({event, mission}, queue.size());
+	if (inserted) queue.push_back(std::move(queued));
+	else queue[it->second] = std::move(queued);
+}
+void EventHandler::flush() {
+	// Listeners may emit more events while flushing, those are dispatched in a following batch
+	while (!queue.empty()) {
+		std::vector<QueuedEvent> batch;
+		batch.swap(queue);
+		queuedIndex.clear();
+		for (auto& queued : batch) {
+			std::visit([&](auto& d) {
+				if constexpr (requires { d.assignedSlots; }) d.assignedSlots = &queued.assignedSlots;
+			}, queued.data);
+			dispatchData(queued.event, queued.data, queued.targetHeroes);
+		}
+	}
+}
+void EventHandler::setDeferred(bool value) {
+	deferred = value;
+	if (!deferred) flush();
 }
 
+#define AS_SLOTS(NAME) \
+	ListenerHandle<NAME> EventHandler::acquire(NAME* listener) { return NAME##Slots.acquire(listener); } \
+	void EventHandler::release(ListenerHandle<NAME> handle) { \
+		if (!NAME##Slots.release(handle)) return; \
+		for (auto& list : NAME##Listeners) list.hasStale = true; \
+		listenersDirty = true; \
+	}
+LISTENER_TYPES(AS_SLOTS)
+#undef AS_SLOTS
+
 void EventHandler::on(Event event, Listener listener) {
+	if (!isValid(event)) throw std::invalid_argument(std::format("Cannot listen to invalid event '{}'", static_cast<std::string>(event)));
 	std::visit([this, event](auto&& arg){
 		using T = std::decay_t<decltype(arg)>;
-		#define AS_ON(NAME) if constexpr (std::is_same_v<T, std::weak_ptr<NAME>>) { if (!arg.expired()) { this->NAME##ToListen.emplace_back(event, arg); } }
+		#define AS_ON(NAME) if constexpr (std::is_same_v<T, ListenerHandle<NAME>>) { this->NAME##ToListen.emplace_back(event, arg); }
 		LISTENER_TYPES(AS_ON)
 		#undef AS_ON
 	}, listener);
+	listenersDirty = true;
+	updateListeners();
 }
 void EventHandler::off(Event event, Listener listener) {
 	std::visit([this, event](auto&& arg){
 		using T = std::decay_t<decltype(arg)>;
-		#define AS_OFF(NAME) if constexpr (std::is_same_v<T, std::weak_ptr<NAME>>) { this->NAME##ToUnlisten.emplace_back(event, arg); }
+		#define AS_OFF(NAME) if constexpr (std::is_same_v<T, ListenerHandle<NAME>>) { this->NAME##ToUnlisten.emplace_back(event, arg); }
 		LISTENER_TYPES(AS_OFF)
 		#undef AS_OFF
 	}, listener);
+	listenersDirty = true;
+	updateListeners();
 }
 
 template<typename T>
-void processUpdateListeners(Listeners<T>& listeners, toListeners<T>& toListen, toListeners<T>& toUnlisten) {
-	for (auto& [event, listener] : toListen) listeners[event].insert(listener);
-	for (auto& [event, listener] : toUnlisten) listeners[event].erase(listener);
+void processUpdateListeners(ListenerSlots<T>& slots, Listeners<T>& listeners, toListeners<T>& toListen, toListeners<T>& toUnlisten) {
+	using Slot = typename ListenerSlots<T>::Slot;
+	constexpr uint32_t NONE = ListenerSlots<T>::NONE;
+	// Moves the last entry into the hole, its slot learns the new position unless that handle went stale
+	auto swapRemove = [&](std::vector<ListenerHandle<T>>& items, uint32_t pos, std::array<uint32_t, Event::COUNT> Slot::* at, Event event) {
+		items[pos] = items.back();
+		items.pop_back();
+		if (pos < items.size()) if (Slot* moved = slots.live(items[pos])) (moved->*at)[event] = pos;
+	};
+	for (auto& [event, handle] : toListen) {
+		Slot* slot = slots.live(handle);
+		if (!slot || slot->at[event] != NONE) continue;
+		auto& list = listeners[event];
+		slot->at[event] = (uint32_t)list.items.size();
+		list.items.push_back(handle);
+		HeroId hero = listenerHero(*slot->listener);
+		if (!hero.valid()) continue;
+		if (hero.index >= list.byHero.size()) list.byHero.resize(hero.index + 1);
+		slot->heroAt[event] = (uint32_t)list.byHero[hero.index].size();
+		list.byHero[hero.index].push_back(handle);
+	}
+	for (auto& [event, handle] : toUnlisten) {
+		if (!isValid(event)) continue;
+		auto& list = listeners[event];
+		Slot* slot = slots.live(handle);
+		// A released listener is already stale in the lists, the compaction below drops it
+		if (!slot) {
+			list.hasStale = true;
+			continue;
+		}
+		if (slot->at[event] == NONE) continue;
+		swapRemove(list.items, std::exchange(slot->at[event], NONE), &Slot::at, event);
+		HeroId hero = listenerHero(*slot->listener);
+		if (slot->heroAt[event] != NONE && hero.index < list.byHero.size()) swapRemove(list.byHero[hero.index], std::exchange(slot->heroAt[event], NONE), &Slot::heroAt, event);
+	}
+	for (size_t event = 0; event < listeners.size(); event++) {
+		auto& list = listeners[event];
+		if (!list.hasStale) continue;
+		auto stale = [&](ListenerHandle<T> handle) { return !slots.get(handle); };
+		std::erase_if(list.items, stale);
+		for (uint32_t pos = 0; pos < list.items.size(); pos++) slots.live(list.items[pos])->at[event] = pos;
+		for (auto& items : list.byHero) {
+			std::erase_if(items, stale);
+			for (uint32_t pos = 0; pos < items.size(); pos++) slots.live(items[pos])->heroAt[event] = pos;
+		}
+		list.hasStale = false;
+	}
 	toListen.clear();
 	toUnlisten.clear();
 }
 void EventHandler::updateListeners() {
-	#define AS_UPDATE(NAME) processUpdateListeners(NAME##Listeners, NAME##ToListen, NAME##ToUnlisten);
+	if (dispatchDepth) return;
+	listenersDirty = false;
+	#define AS_UPDATE(NAME) processUpdateListeners(NAME##Slots, NAME##Listeners, NAME##ToListen, NAME##ToUnlisten);
 	LISTENER_TYPES(AS_UPDATE)
 	#undef AS_UPDATE
 }
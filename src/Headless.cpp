@@ -0,0 +1,186 @@
+#ifdef HEADLESS_BUILD
+#include <raylib-cpp.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <Utils.hpp>
+#include <MissionsHandler.hpp>
+#include <HeroesHandler.hpp>
+#include <CityMap.hpp>
+#include <Mission.hpp>
+#include <Hero.hpp>
+#include <EventHandler.hpp>
+#include <WorkerPool.hpp>
+#include <TimerWheel.hpp>
+#include <Dispatcher.hpp>
+
+// Same virtual resolution as the debug window, mission positions and the city map are laid out for it
+float bgScale = 1.0f;
+raylib::Vector2 screenSize{960, 540};
+
+namespace {
+	struct Options {
+		long ticks = 10000;
+		float rate = 60.0f;
+		unsigned int seed = 0;
+		bool idle = false;
+		bool deferredEvents = false;
+		long threads = -1;
+		bool fastForward = false;
+		long autoDispatch = 0;
+	};
+
+	// Below this a step could leave a hero's distance unchanged in float precision and never reach the event
+	constexpr float MIN_STEP = 1e-3f;
+
+	void printUsage(const char* exe) {
+		Utils::println("Usage: {} [--ticks N] [--rate TICKS_PER_SECOND] [--seed N] [--idle] [--deferred-events] [--threads N] [--fast-forward] [--auto-dispatch MOVES]", exe);
+		Utils::println("  --ticks  number of simulation ticks to run (default 10000)");
+		Utils::println("  --rate   fixed tick rate, each tick advances 4/rate seconds like a rendered frame (default 60)");
+		Utils::println("  --seed   seed for rand(), 0 keeps the default sequence");
+		Utils::println("  --idle   do not dispatch heroes, missions are left to expire");
+		Utils::println("  --deferred-events  queue mission events and dispatch them once at the end of each tick");
+		Utils::println("  --fast-forward  jump from one scheduled event to the next instead of stepping at the tick rate, the run still covers --ticks worth of time");
+		Utils::println("  --auto-dispatch  send teams planned by the Dispatcher, MOVES search moves per plan and thread, instead of the first free heroes");
+		Utils::println("  --threads  worker threads next to the main one, 0 runs serially (default one less than the cores)");
+	}
+
+	Options parseArgs(int argc, char** argv) {
+		Options opts;
+		for (int i = 1; i < argc; i++) {
+			std::string arg = argv[i];
+			auto next = [&]() -> std::string {
+				if (i + 1 >= argc) throw std::invalid_argument(std::format("Missing value for {}", arg));
+				return argv[++i];
+			};
+			if (arg == "--ticks") opts.ticks = std::stol(next());
+			else if (arg == "--rate") opts.rate = std::stof(next());
+			else if (arg == "--seed") opts.seed = std::stoul(next());
+			else if (arg == "--idle") opts.idle = true;
+			else if (arg == "--deferred-events") opts.deferredEvents = true;
+			else if (arg == "--threads") opts.threads = std::stol(next());
+			else if (arg == "--fast-forward") opts.fastForward = true;
+			else if (arg == "--auto-dispatch") opts.autoDispatch = std::stol(next());
+			else if (arg == "--help" || arg == "-h") {
+				printUsage(argv[0]);
+				std::exit(0);
+			} else throw std::invalid_argument(std::format("Unknown argument '{}'", arg));
+		}
+		if (opts.ticks <= 0) throw std::invalid_argument("--ticks must be positive");
+		if (opts.rate <= 0) throw std::invalid_argument("--rate must be positive");
+		if (opts.threads < -1) throw std::invalid_argument("--threads must not be negative");
+		if (opts.autoDispatch < 0) throw std::invalid_argument("--auto-dispatch must not be negative");
+		return opts;
+	}
+
+	// Heroes walk before the timers run, so one sent off by a timer at the end of the step starts its route then.
+	// Arrivals land after them, with the wheel at the arrival time.
+	void step(float deltaTime) {
+		auto& hh = HeroesHandler::inst();
+		hh.move(deltaTime);
+		TimerWheel::inst().advance(deltaTime);
+		CityMap::inst().update(deltaTime);
+		hh.applyArrivals();
+		MissionsHandler::inst().update(deltaTime);
+		EventHandler::inst().flush();
+	}
+
+	// Seconds until the next thing that changes the simulation on its own: a timer, a hero arriving or a queued mission.
+	// Speeds only change at events, so heroes move exactly that far along their routes in the jump.
+	float nextEventIn() {
+		auto& wheel = TimerWheel::inst();
+		double next = wheel.nextDeadline() - wheel.now();
+		next = std::min({next, (double)HeroesHandler::inst().nextArrival(), (double)MissionsHandler::inst().nextQueued()});
+		return (float)next;
+	}
+
+	// Stand-in for the player: sends every available hero to pending missions and reviews finished ones.
+	// With autoDispatch the teams come from a Dispatcher plan, made whenever a mission is waiting and someone is free.
+	// Disruptions are left to time out, there is no one to pick an option.
+	void operate(HeroesHandler& hh, MissionsHandler& mh, bool autoDispatch) {
+		if (autoDispatch) {
+			bool waiting = std::any_of(BEGEND(mh.active), [&](MissionId id) { return mh[id].status == Mission::PENDING; });
+			bool free = std::any_of(BEGEND(hh.roster), [&](HeroId id) { return hh[id].status() == Hero::AVAILABLE && hh[id].health != Hero::DOWNED; });
+			if (waiting && free) {
+				auto& dispatcher = Dispatcher::inst();
+				dispatcher.plan();
+				for (MissionId id : mh.active) if (mh[id].status == Mission::PENDING && dispatcher.apply(id)) mh[id].changeStatus(Mission::TRAVELLING);
+			}
+		}
+		for (MissionId id : mh.active) {
+			auto& mission = mh[id];
+			if (mission.status == Mission::PENDING && !autoDispatch) {
+				std::vector<HeroId> team;
+				for (HeroId hero_id : hh.roster) {
+					if ((int)team.size() >= mission.slots) break;
+					auto& hero = hh[hero_id];
+					if (hero.status() == Hero::AVAILABLE && hero.health != Hero::DOWNED) team.push_back(hero_id);
+				}
+				if (team.empty()) continue;
+				mission.changeStatus(Mission::SELECTED);
+				for (HeroId hero_id : team) mission.assignHero(hero_id);
+				mission.changeStatus(Mission::TRAVELLING);
+			} else if (mission.status == Mission::AWAITING_REVIEW) {
+				mission.changeStatus(Mission::REVIEWING);
+				mission.changeStatus(Mission::DONE);
+			}
+		}
+	}
+}
+
+int main(int argc, char** argv) {
+	try {
+		Options opts = parseArgs(argc, argv);
+		if (opts.seed) srand(opts.seed);
+
+		HeroesHandler& heroesHandler = HeroesHandler::inst();
+		MissionsHandler& missionsHandler = MissionsHandler::inst();
+		EventHandler& eventHandler = EventHandler::inst();
+		// Loaded up front so parsing the map is not timed
+		CityMap::inst();
+		eventHandler.setDeferred(opts.deferredEvents);
+		if (opts.threads >= 0) WorkerPool::inst().resize(opts.threads);
+		// Plans are limited by moves only, so they don't depend on how fast the machine is
+		auto& dispatcher = Dispatcher::inst();
+		dispatcher.options.budget = 0.0f;
+		dispatcher.options.moves = opts.autoDispatch;
+		if (opts.seed) dispatcher.options.seed = opts.seed;
+		float deltaTime = 4.0f / opts.rate;
+		double simulated = opts.ticks * (double)deltaTime;
+
+		long steps = 0;
+		auto start = std::chrono::steady_clock::now();
+		if (opts.fastForward) {
+			for (double now = 0.0; now < simulated; steps++) {
+				if (!opts.idle) operate(heroesHandler, missionsHandler, opts.autoDispatch > 0);
+				float jump = std::min(std::max(nextEventIn(), MIN_STEP), (float)(simulated - now));
+				step(jump);
+				now += jump;
+			}
+		} else for (; steps < opts.ticks; steps++) {
+			if (!opts.idle) operate(heroesHandler, missionsHandler, opts.autoDispatch > 0);
+			step(deltaTime);
+		}
+		std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+		double seconds = elapsed.count();
+		std::string unit = opts.fastForward ? "events" : "ticks";
+		long stepsPerSec = seconds > 0 ? (long)(steps / seconds) : 0;
+		Utils::println("Ran {} {} ({} simulated seconds) in {} seconds", steps, unit, simulated, seconds);
+		Utils::println("Throughput: {} {}/sec", stepsPerSec, unit);
+		Utils::println("Missions: {} active, {} finished", missionsHandler.active.size(), missionsHandler.previous.size());
+
+		missionsHandler.clear();
+		heroesHandler.clear();
+	} catch (const std::exception& e) {
+		std::cerr << e.what() << std::endl;
+		return 1;
+	}
+
+	return 0;
+}
+#endif // HEADLESS_BUILD
@@ -1,7 +1,9 @@
+#include <algorithm>
 #include <cctype>
 #include <tuple>
 #include <memory>
 #include <typeinfo>
+#include <utility>
 
 #include <Utils.hpp>
 #include <Common.hpp>
@@ -17,65 +19,133 @@
 
 using nlohmann::json;
 
-Hero::Hero(const json& data) {
+Hero::Hero(const json& data, HeroId heroId, HeroStore& heroStore) : id{heroId}, store{&heroStore} {
+	store->reset(id.index);
 	// Utils::println("Initializing hero {}", data.at("name").get<std::string>());
 	for (auto attr : Attribute::Values) unconfirmed_attributes[attr] = 0;
 	Hero::from_json(data, *this);
 }
 
-AttrMap<int> Hero::attributes() {
-	if (needsAttrCalc) {
+// Unlinks both sides of the attribute graph: teammates' bonuses still list this hero as a target,
+// and teammates still hold this hero's bonuses as sources
+Hero::~Hero() {
+	for (AttrBonusEffect* source : attrSources) std::erase(source->attrTargets, this);
+	for (auto& power : powers) for (auto& effect : power.effects) {
+		auto* source = dynamic_cast<AttrBonusEffect*>(effect.get());
+		if (!source) continue;
+		for (Hero* target : source->attrTargets) {
+			if (target == this) continue;
+			std::erase(target->attrSources, source);
+			target->invalidateAttributes();
+		}
+		source->attrTargets.clear();
+	}
+}
+
+const AttrMap<int>& Hero::attributes() {
+	if (memoVersion != attrVersion) {
+		AttrMap<int> previous = memo_attributes;
 		memo_attributes = real_attributes;
+		for (AttrBonusEffect* source : attrSources) if (source->power->unlocked) memo_attributes += source->bonus;
+		// Effects outside the graph can still adjust through HeroCalcAttr, they must invalidate the hero themselves
 		auto& eh = EventHandler::inst();
-		eh.emit<Event::HeroCalcAttr>({name}, name, &memo_attributes);
+		eh.emit<Event::HeroCalcAttr>({&id, 1}, id, &memo_attributes);
 		for (auto& [attr, val] : memo_attributes) {
 			if (health == Health::WOUNDED) { if (val > 1) val--; }
 			else if (health == Health::DOWNED) val = 1;
 		}
-		needsAttrCalc = false;
+		memoVersion = attrVersion;
+		if (!attrSnapshotVersion || !(memo_attributes == previous)) attrSnapshotVersion = ++attrSnapshotCounter;
 	}
 	return memo_attributes;
 }
+Hero::AttrSnapshot Hero::attrSnapshot() {
+	const AttrMap<int>& values = attributes();
+	return {values, attrSnapshotVersion};
+}
+
+void Hero::updateAttrSources() {
+	std::vector<AttrBonusEffect*> sources;
+	for (auto& power : powers) for (auto& effect : power.effects) {
+		auto* source = dynamic_cast<AttrBonusEffect*>(effect.get());
+		if (source && source->appliesTo == AttrBonusEffect::SELF) sources.push_back(source);
+	}
+	if (mission.valid()) {
+		auto& hh = HeroesHandler::inst();
+		auto& slots = MissionsHandler::inst()[mission].assignedSlots;
+		auto it = std::find(BEGEND(slots), id);
+		int mySlot = it != slots.end() ? it - slots.begin() : -1;
+		for (int slot = 0; mySlot != -1 && slot < (int)slots.size(); slot++) {
+			if (!slots[slot].valid()) continue;
+			Hero& mate = hh[slots[slot]];
+			if (mate.mission != mission) continue;
+			for (auto& power : mate.powers) for (auto& effect : power.effects) {
+				auto* source = dynamic_cast<AttrBonusEffect*>(effect.get());
+				if (source && source->appliesTo != AttrBonusEffect::SELF && source->applies(slot, mySlot)) sources.push_back(source);
+			}
+		}
+	}
+	if (sources == attrSources) return;
+
+	for (AttrBonusEffect* source : attrSources) std::erase(source->attrTargets, this);
+	for (AttrBonusEffect* source : sources) source->attrTargets.push_back(this);
+	attrSources = std::move(sources);
+	invalidateAttributes();
+}
+
+AttrMap<int> Hero::soloAttributes() {
+	AttrMap<int> values = attributes();
+	for (AttrBonusEffect* source : attrSources) if (source->appliesTo != AttrBonusEffect::SELF && source->power->unlocked) values -= source->bonus;
+	return values;
+}
+std::vector<AttrBonusEffect*> Hero::teamBonuses() const {
+	std::vector<AttrBonusEffect*> bonuses;
+	for (auto& power : powers) for (auto& effect : power.effects) {
+		auto* source = dynamic_cast<AttrBonusEffect*>(effect.get());
+		if (source && power.unlocked && source->appliesTo != AttrBonusEffect::SELF) bonuses.push_back(source);
+	}
+	return bonuses;
+}
+
+// Team membership is what links heroes in the graph, both the old and the new team get relinked
+void Hero::setMission(MissionId msn) {
+	if (msn == mission) return;
+	MissionId previous = std::exchange(mission, msn);
+	auto& hh = HeroesHandler::inst();
+	auto& mh = MissionsHandler::inst();
+	for (MissionId team : {previous, mission}) {
+		if (!team.valid()) continue;
+		for (HeroId mate : mh[team].assignedSlots) if (mate.valid() && mate != id) hh[mate].updateAttrSources();
+	}
+	updateAttrSources();
+}
 
 float Hero::travelSpeed() { return travelSpeedMult * (50 + 2.5f*attributes()[Attribute::MOBILITY]); }
 
 bool Hero::canFly() const {
-	if (flies) return true;
-	if (!mission.empty()) {
-		auto heroes = MissionsHandler::inst()[mission].assignedHeroes;
-		if (heroes.contains("Sonar")) return true;
-	}
-	return false;
+	if (has(Capability::FLIGHT)) return true;
+	return mission.valid() && (MissionsHandler::inst()[mission].teamCapabilities & Capability::TEAM_FLIGHT);
 }
 
 int Hero::maxExp() const { return 700 + 300 * level + expOffset; }
 
-void Hero::update(float deltaTime) {
-	if (status == Hero::TRAVELLING || status == Hero::RETURNING) {
-		float dist = pos.Distance(path);
-		float speed = travelSpeed() * deltaTime;
-		if (dist <= speed) {
-			pos = path;
-			bool completed = updatePath();
-			if (completed) {
-				if (status == Hero::TRAVELLING) {
-					Mission& ms = MissionsHandler::inst()[mission];
-					changeStatus(Hero::WORKING);
-					if (ms.status != Mission::PROGRESS) ms.changeStatus(Mission::PROGRESS);
-				}
-				else changeStatus(Hero::RESTING, restingTime);
-			}
-		} else pos = pos.MoveTowards(path, speed);
-	} else elapsedTime += deltaTime;
-
-	if (elapsedTime >= finishTime) switch (status) {
-		case Hero::RESTING:
-			if (mission.empty()) changeStatus(Hero::AVAILABLE);
-			else changeStatus(Hero::AWAITING_REVIEW);
-			break;
-		default:
-			break;
+// Applies what HeroStore::advance flagged, the end of a trip
+void Hero::arrive() {
+	if (status() == Hero::TRAVELLING) {
+		Mission& ms = MissionsHandler::inst()[mission];
+		changeStatus(Hero::WORKING);
+		// Progress runs at the share of the team already working. Only the first arrival starts it, a late one just
+		// speeds up the clock, where the per-frame update used to force PROGRESS and so cut a running disruption short.
+		if (ms.status == Mission::TRAVELLING) ms.changeStatus(Mission::PROGRESS);
+		else ms.updateClock();
 	}
+	else changeStatus(Hero::RESTING, restingTime);
+}
+// Rest timer callback, the hero may have been reloaded or moved on since it was scheduled
+void Hero::rested() {
+	if (status() != Hero::RESTING) return;
+	if (!mission.valid()) changeStatus(Hero::AVAILABLE);
+	else changeStatus(Hero::AWAITING_REVIEW);
 }
 
 void Hero::renderUI(raylib::Rectangle rect) {
@@ -84,8 +154,8 @@ void Hero::renderUI(raylib::Rectangle rect) {
 	raylib::Color color{GRAY}, txtColor{};
 	std::string txt;
 	float progress = 1.0f;
-	if (HeroesHandler::inst().isHeroSelected(name)) color = SKYBLUE;
-	else switch(status) {
+	if (HeroesHandler::inst().isHeroSelected(id)) color = SKYBLUE;
+	else switch(status()) {
 		case Hero::ASSIGNED:
 			color = ORANGE;
 			break;
@@ -105,7 +175,7 @@ void Hero::renderUI(raylib::Rectangle rect) {
 		case Hero::RESTING:
 			txt = "RESTING";
 			txtColor = ColorLerp(LIME, SKYBLUE, 0.6f);
-			progress = 1.0f - (elapsedTime / restingTime);
+			progress = 1.0f - (elapsedTime() / restingTime);
 			break;
 		case Hero::AWAITING_REVIEW:
 			txt = "AWAITING REVIEW";
@@ -149,13 +219,14 @@ void Hero::renderUI(raylib::Rectangle rect) {
 	nameRect.width = rect.width - 4.0f; nameRect.Draw(Dispatch::UI::bgMed);
 	Utils::drawTextAnchored(name, rect, Utils::Anchor::bottom, Dispatch::UI::fontTitle, Dispatch::UI::textColor, 14.0f, 2.0f, {0.0f, -2.0f});
 
-	if (status == Hero::TRAVELLING || status == Hero::RETURNING) {
-		pos.DrawCircle(22, BLACK);
-		pos.DrawCircle(21, WHITE);
-		pos.DrawCircle(20, status == Hero::TRAVELLING ? BLUE : YELLOW);
+	if (status() == Hero::TRAVELLING || status() == Hero::RETURNING) {
+		raylib::Vector2 p = pos();
+		p.DrawCircle(22, BLACK);
+		p.DrawCircle(21, WHITE);
+		p.DrawCircle(20, status() == Hero::TRAVELLING ? BLUE : YELLOW);
 		if (TM.has(img_key)) {
 			raylib::Texture& img = TM[img_key];
-			Utils::drawCircularTexture(img, pos, 20.0f, 2.0f);
+			Utils::drawCircularTexture(img, p, 20.0f, 2.0f);
 		}
 	}
 
@@ -169,20 +240,24 @@ void Hero::renderUI(raylib::Rectangle rect) {
 
 
 void Hero::changeStatus(Status st, float fnTime) { changeStatus(st, mission, fnTime); }
-void Hero::changeStatus(Status st, std::string msn, float fnTime) {
-	status = st;
-	mission = msn;
-	finishTime = fnTime;
-	elapsedTime = 0;
-	updatePath();
+void Hero::changeStatus(Status st, MissionId msn, float fnTime) {
+	auto& wheel = TimerWheel::inst();
+	status() = st;
+	store->touch(id.index);
+	setMission(msn);
+	finishTime() = fnTime;
+	store->since[id.index] = wheel.now();
+	wheel.cancel(timer);
+	if (st == Hero::RESTING) timer = wheel.schedule(fnTime, [hero = id]{ HeroesHandler::inst()[hero].rested(); });
+	planRoute();
 }
 void Hero::wound(){
-	if (health != Health::DOWNED) needsAttrCalc = true;
+	if (health != Health::DOWNED) invalidateAttributes();
 	if (health == Health::NORMAL) health = Health::WOUNDED;
 	else health = Health::DOWNED;
 }
 void Hero::heal(){
-	if (health != Health::NORMAL) needsAttrCalc = true;
+	if (health != Health::NORMAL) invalidateAttributes();
 	if (health == Health::DOWNED) health = Health::WOUNDED;
 	else health = Health::NORMAL;
 }
@@ -203,7 +278,7 @@ void Hero::applyAttributeChanges() {
 		real_attributes[attr] += unconfirmed_attributes[attr];
 		unconfirmed_attributes[attr] = 0;
 	}
-	needsAttrCalc = true;
+	invalidateAttributes();
 }
 void Hero::resetAttributeChanges() {
 	for (int i = 0; i < Attribute::COUNT; i++) {
@@ -212,32 +287,16 @@ void Hero::resetAttributeChanges() {
 		unconfirmed_attributes[attr] = 0;
 	}
 }
-bool Hero::updatePath() {
-	if (status == Hero::TRAVELLING || status == Hero::RETURNING) {
-		CityMap& cityMap = CityMap::inst();
-		raylib::Vector2 dest = (status == Hero::TRAVELLING) ? MissionsHandler::inst()[mission].position : cityMap.points[89];
-
-		int posIDX = cityMap.closestPoint(pos);
-		int destIDX = cityMap.closestPoint(dest);
-		int pathIDX = cityMap.shortestPath(posIDX, destIDX);
-
-		if (path == raylib::Vector2{0,0}) {
-			if (status == Hero::TRAVELLING) posIDX = 89;
-			path = cityMap.points[posIDX];
-		} else if (canFly()) {
-			path = dest;
-			return pos == dest;
-		} else if (posIDX == destIDX) {
-			if (pos == dest) {
-				path = raylib::Vector2{0,0};
-				return true;
-			}
-			path = dest;
-		} else {
-			path = cityMap.points[pathIDX];
-		}
-	}
-	return false;
+// The whole trip is planned when leaving, HeroStore::advance then walks it by distance
+void Hero::planRoute() {
+	if (status() != Hero::TRAVELLING && status() != Hero::RETURNING) return;
+	CityMap& cityMap = CityMap::inst();
+	bool travelling = status() == Hero::TRAVELLING;
+	raylib::Vector2 dest = travelling ? MissionsHandler::inst()[mission].position : cityMap.points[cityMap.base];
+	int first = travelling ? cityMap.base : cityMap.closestPoint(pos());
+	cityMap.planTrip(store->route[id.index], pos(), first, dest, canFly());
+	store->travelled[id.index] = 0.0f;
+	store->cursor[id.index] = 0;
 }
 
 
@@ -276,6 +335,8 @@ std::string_view Hero::HealthToString(Health hlt) {
 						}
 
 void Hero::to_json(nlohmann::json& j, const Hero& hero) {
+	std::vector<std::string> capabilities;
+	for (Capability::Value capability : Capability::Values) if (hero.has(capability)) capabilities.emplace_back(Capability::toString(capability));
 	j = json{
 		{"name", hero.name},
 		{"nickname", hero.nickname},
@@ -289,9 +350,9 @@ void Hero::to_json(nlohmann::json& j, const Hero& hero) {
 		{"health", hero.health},
 		{"travelSpeedMult", hero.travelSpeedMult},
 		// {"elapsedTime", hero.elapsedTime},
-		{"finishTime", hero.finishTime},
+		{"finishTime", hero.finishTime()},
 		{"restingTime", hero.restingTime},
-		{"flies", hero.flies},
+		{"capabilities", capabilities},
 		{"level", hero.level},
 		{"exp", hero.exp},
 		{"expOffset", hero.expOffset},
@@ -327,9 +388,10 @@ void Hero::from_json(const nlohmann::json& j, Hero& hero) {
 	READ(j, health);
 	READ(j, travelSpeedMult);
 	// READ(j, elapsedTime);
-	READ(j, finishTime);
+	if (j.contains("finishTime")) j["finishTime"].get_to(hero.finishTime());
 	READ(j, restingTime);
-	READ(j, flies);
+	if (j.value("flies", false)) hero.capabilities |= Capability::FLIGHT;
+	if (j.contains("capabilities")) for (auto& capability : j["capabilities"]) hero.capabilities |= Capability::fromString(capability.get<std::string>());
 	READ(j, level);
 	READ(j, exp);
 	READ(j, expOffset);
@@ -347,4 +409,5 @@ void Hero::from_json(const nlohmann::json& j, Hero& hero) {
 			p.from_json(jp);
 		}
 	}
+	hero.updateAttrSources();
 }
@@ -0,0 +1,108 @@
+#include <algorithm>
+
+#include <Utils.hpp>
+#include <HeroIndex.hpp>
+
+void HeroIndex::set(HeroId hero, const AttrMap<int>& attributes) {
+	if (!hero.valid()) throw std::invalid_argument("HeroIndex cannot hold an invalid hero");
+	if (hero.index >= present.size()) {
+		present.resize(hero.index + 1, 0);
+		values.resize(hero.index + 1);
+		seen.resize(hero.index + 1, 0);
+	}
+	AttrMap<int>& held = values[hero.index];
+	if (present[hero.index]) {
+		// Entries are moved by re-keying their nodes, an update doesn't allocate
+		for (Attribute::Value attr : Attribute::Values) {
+			if (held[attr] == attributes[attr]) continue;
+			auto node = columns[attr].extract({held[attr], hero.index});
+			node.value().first = attributes[attr];
+			columns[attr].insert(std::move(node));
+		}
+	} else {
+		present[hero.index] = 1;
+		count++;
+		for (Attribute::Value attr : Attribute::Values) columns[attr].insert({attributes[attr], hero.index});
+	}
+	held = attributes;
+}
+bool HeroIndex::erase(HeroId hero) {
+	if (!contains(hero)) return false;
+	for (Attribute::Value attr : Attribute::Values) columns[attr].erase({values[hero.index][attr], hero.index});
+	present[hero.index] = 0;
+	count--;
+	return true;
+}
+void HeroIndex::clear() {
+	for (auto& column : columns) column.clear();
+	values.clear();
+	present.clear();
+	seen.clear();
+	count = 0;
+}
+
+// Threshold walk: a hero not reached yet is at most the next value down every column, so once the worst of the k
+// held is at least the fit those values would give, nobody left can get in. Attributes the mission doesn't ask for
+// can't tell heroes apart, their columns are not walked.
+std::vector<HeroIndex::Match> HeroIndex::best(const AttrMap<int>& required, size_t k) const {
+	std::vector<Match> found;
+	if (k == 0 || count == 0) return found;
+	auto fit = [&](uint32_t index) {
+		int score = 0;
+		for (Attribute::Value attr : Attribute::Values) score += std::min(values[index][attr], required[attr]);
+		return score;
+	};
+
+	std::vector<Attribute::Value> asked;
+	int rest = 0;
+	for (Attribute::Value attr : Attribute::Values) {
+		if (required[attr] > 0) asked.push_back(attr);
+		else rest += required[attr];
+	}
+	if (asked.empty()) {
+		asked.push_back(Attribute::Values[0]);
+		rest -= required[Attribute::Values[0]];
+	}
+	std::array<Column::const_iterator, Attribute::COUNT> next;
+	for (Attribute::Value attr : asked) next[attr] = columns[attr].begin();
+
+	// Kept as a heap with the worst on top, equal fits keep the one found first
+	std::vector<std::pair<Match, size_t>> kept;
+	kept.reserve(std::min(k, count) + 1);
+	auto better = [](const std::pair<Match, size_t>& a, const std::pair<Match, size_t>& b) { return a.first.score != b.first.score ? a.first.score > b.first.score : a.second < b.second; };
+	// Columns list the same heroes, each is rated once. Only the flags set here are cleared again, a query stays in
+	// proportion to the heroes it reaches.
+	reached.clear();
+	size_t order = 0;
+	while (true) {
+		for (Attribute::Value attr : asked) {
+			if (next[attr] == columns[attr].end()) continue;
+			uint32_t index = (next[attr]++)->second;
+			if (seen[index]) continue;
+			seen[index] = 1;
+			reached.push_back(index);
+			std::pair<Match, size_t> candidate{{HeroId{index}, fit(index)}, order++};
+			if (kept.size() < k) {
+				kept.push_back(candidate);
+				std::push_heap(BEGEND(kept), better);
+			} else if (better(candidate, kept.front())) {
+				std::pop_heap(BEGEND(kept), better);
+				kept.back() = candidate;
+				std::push_heap(BEGEND(kept), better);
+			}
+		}
+		// Every column holds every hero, one running out means all of them were seen
+		int threshold = rest;
+		bool done = false;
+		for (Attribute::Value attr : asked) {
+			if (next[attr] == columns[attr].end()) done = true;
+			else threshold += std::min(next[attr]->first, required[attr]);
+		}
+		if (done || (kept.size() == k && kept.front().first.score >= threshold)) break;
+	}
+
+	for (uint32_t index : reached) seen[index] = 0;
+	std::sort_heap(BEGEND(kept), better);
+	for (auto& [match, position] : kept) found.push_back(match);
+	return found;
+}
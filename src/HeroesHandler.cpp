@@ -1,5 +1,6 @@
 #include <string>
 #include <algorithm>
+#include <limits>
 #include <format>
 
 #include <Utils.hpp>
@@ -10,6 +11,7 @@
 #include <MissionsHandler.hpp>
 #include <UI.hpp>
 #include <Effect.hpp>
+#include <WorkerPool.hpp>
 
 #include <nlohmann/json.hpp>
 using nlohmann::json;
@@ -32,40 +34,82 @@ void HeroesHandler::loadHeroes(const std::string& filePath, bool activate) {
 	if (!data.is_array()) throw std::runtime_error("Heroes error: Top-level JSON must be an array of heroes.");
 	Utils::println("Read {} heroes", data.size());
 	for (auto& hero_data : data) {
-		auto hero = std::make_unique<Hero>(hero_data);
-		// Utils::println("Loaded hero '{}'", hero->name);
-		if (activate) roster.push_back(hero->name);
-		heroes[hero->name] = std::move(hero);
+		HeroId hero = addHero(hero_data);
+		// Utils::println("Loaded hero '{}'", getRef(hero).name);
+		if (activate) roster.push_back(hero);
 	}
 }
+HeroId HeroesHandler::addHero(const json& data) {
+	auto found = ids.find(data.at("name").get<std::string>());
+	HeroId hero = found != ids.end() ? found->second : HeroId{(uint32_t)heroes.size()};
+	auto ptr = std::make_unique<Hero>(data, hero, store);
+	if (found != ids.end()) {
+		TimerWheel::inst().cancel(heroes[hero.index]->timer);
+		heroes[hero.index] = std::move(ptr);
+	}
+	else {
+		ids[ptr->name] = hero;
+		heroes.push_back(std::move(ptr));
+	}
+	return hero;
+}
+void HeroesHandler::clear() {
+	for (auto& hero : heroes) TimerWheel::inst().cancel(hero->timer);
+	selected = {};
+	roster.clear();
+	ids.clear();
+	heroes.clear();
+	store.clear();
+	availableIndex.clear();
+}
 
 
-const Hero* HeroesHandler::get(const std::string& name) const { return (heroes.at(name).get()); }
-Hero* HeroesHandler::get(const std::string& name) { return (heroes.at(name).get()); }
-const Hero& HeroesHandler::getRef(const std::string& name) const { return *get(name); }
-Hero& HeroesHandler::getRef(const std::string& name) { return *get(name); }
-const Hero& HeroesHandler::operator[](const std::string& name) const { return getRef(name); }
-Hero& HeroesHandler::operator[](const std::string& name) { return getRef(name); }
+const Hero* HeroesHandler::get(HeroId id) const { return (heroes.at(id.index).get()); }
+Hero* HeroesHandler::get(HeroId id) { return (heroes.at(id.index).get()); }
+const Hero& HeroesHandler::getRef(HeroId id) const { return *get(id); }
+Hero& HeroesHandler::getRef(HeroId id) { return *get(id); }
+HeroId HeroesHandler::id(const std::string& name) const { return ids.at(name); }
+const Hero& HeroesHandler::operator[](HeroId id) const { return getRef(id); }
+Hero& HeroesHandler::operator[](HeroId id) { return getRef(id); }
+const Hero& HeroesHandler::operator[](const std::string& name) const { return getRef(id(name)); }
+Hero& HeroesHandler::operator[](const std::string& name) { return getRef(id(name)); }
 Hero* HeroesHandler::selectedHero() { return paused() ? get(selected) : (Hero*)nullptr; }
 
-bool HeroesHandler::paused() const { return !selected.empty(); }
+// Only the heroes touched since the last call are looked at, a hero can be touched again while the list is walked
+const HeroIndex& HeroesHandler::available() {
+	for (size_t i = 0; i < store.touched.size(); i++) {
+		uint32_t index = store.touched[i];
+		store.dirty[index] = 0;
+		if (index >= heroes.size()) {
+			availableIndex.erase(HeroId{index});
+			continue;
+		}
+		Hero& hero = *heroes[index];
+		if (hero.status() == Hero::AVAILABLE && hero.health != Hero::DOWNED) availableIndex.set(hero.id, hero.soloAttributes());
+		else availableIndex.erase(hero.id);
+	}
+	store.touched.clear();
+	return availableIndex;
+}
+
+bool HeroesHandler::paused() const { return selected.valid(); }
 
-bool HeroesHandler::isHeroSelected(const std::string& name) const { return name == selected; }
+bool HeroesHandler::isHeroSelected(HeroId id) const { return id == selected; }
 
 void HeroesHandler::renderUI() {
 	raylib::Rectangle heroesRect{158*bgScale, 804*bgScale, 1603*bgScale, 236*bgScale};
 	raylib::Rectangle heroRect{heroesRect.x, heroesRect.y, 185*bgScale, heroesRect.height};
 	std::vector<int> Ws = {180, 185, 189, 192, 192, 189, 185, 180};
 	int spacing = (heroesRect.width - heroRect.width * roster.size()) / (roster.size() - 1);
-	for (auto [idx, hero_name] : Utils::enumerate(roster)) {
-		auto& hero = getRef(hero_name);
+	for (auto [idx, hero_id] : Utils::enumerate(roster)) {
+		auto& hero = getRef(hero_id);
 		int i = std::min(idx, (roster.size()-1)-idx);
 		heroRect.width = Ws[i] * bgScale;
 		hero.renderUI(heroRect);
 		heroRect.x += heroRect.width + spacing;
 	}
 
-	int points_available = std::accumulate(BEGEND(roster), 0, [&](int tot, const std::string& hero_name){ return tot + getRef(hero_name).skillPoints; });
+	int points_available = std::accumulate(BEGEND(roster), 0, [&](int tot, HeroId hero){ return tot + getRef(hero).skillPoints; });
 	if (points_available) {
 		auto rect = Utils::anchorRect(detailsTabButton, {15.0f, 15.0f}, Utils::Anchor::topLeft, {}, Utils::AnchorType::center);
 		rect.Draw(Dispatch::UI::bgMed);
@@ -76,18 +120,22 @@ void HeroesHandler::renderUI() {
 	if (paused()) layoutHeroDetails.render();
 }
 
-void updateLayoutStatsData(Dispatch::UI::Layout& layout, Hero& hero) {
+void updateLayoutStatsData(Dispatch::UI::Layout& layout, Hero& hero, unsigned long& shownVersion) {
 	auto* confirm = layout.get<Dispatch::UI::Button>("stats-confirm");
 	auto* reset = layout.get<Dispatch::UI::Button>("stats-reset");
 	if (!confirm) throw std::runtime_error("Hero details layout is missing 'stats-confirm' element or it is of the wrong type.");
 	if (!reset) throw std::runtime_error("Hero details layout is missing 'stats-reset' element or it is of the wrong type.");
 
-	const auto& attrs = hero.attributes();
+	auto [attrs, version] = hero.attrSnapshot();
 	const auto& unc_attrs = hero.unconfirmed_attributes;
 	int totalUnconfirmed = 0;
 
 	layout.updateSharedData("skillPoints", std::to_string(hero.skillPoints));
-	layout.updateSharedData("attributes", attrs);
+	// Skip converting the attributes to json when the layout already shows this snapshot
+	if (version != shownVersion) {
+		layout.updateSharedData("attributes", attrs);
+		shownVersion = version;
+	}
 	for (Attribute::Value attr : Attribute::Values) {
 		std::string attr_str = (std::string)Attribute(attr).toString();
 		std::string str_minus = std::format("stats-{}-minus", attr_str);
@@ -111,30 +159,29 @@ void updateLayoutStatsData(Dispatch::UI::Layout& layout, Hero& hero) {
 }
 
 bool HeroesHandler::handleInput() {
-	auto selectedMission = MissionsHandler::inst().selected;
-	auto* mission = selectedMission.empty() ? nullptr : &MissionsHandler::inst()[selectedMission];
-	auto missionStatus = selectedMission.empty() ? Mission::DONE : mission->status;
+	auto* mission = MissionsHandler::inst().selectedMission();
+	auto missionStatus = mission ? mission->status : Mission::DONE;
 	if (paused()) layoutHeroDetails.handleInput();
 	if (raylib::Mouse::IsButtonPressed(MOUSE_BUTTON_LEFT)) {
 		raylib::Vector2 mousePos = raylib::Mouse::GetPosition();
 		raylib::Rectangle heroesRect{158*bgScale, 804*bgScale, 1603*bgScale, 236*bgScale};
 		if (heroesRect.CheckCollision(mousePos)) {
-			for (auto [idx, hero_name] : Utils::enumerate(roster)) {
-				auto& hero = getRef(hero_name);
+			for (HeroId hero_id : roster) {
+				auto& hero = getRef(hero_id);
 				if (hero.uiRect.CheckCollision(mousePos)) {
 					if (missionStatus == Mission::SELECTED) {
-						if ((hero.status != Hero::AVAILABLE && hero.status != Hero::ASSIGNED) || hero.health == Hero::DOWNED) return false;
-						mission->toggleHero(hero_name);
+						if ((hero.status() != Hero::AVAILABLE && hero.status() != Hero::ASSIGNED) || hero.health == Hero::DOWNED) return false;
+						mission->toggleHero(hero_id);
 						return true;
-					} else if (selectedMission.empty()) {
-						selectHero(hero_name);
+					} else if (!mission) {
+						selectHero(hero_id);
 						return true;
 					}
 				}
 			}
 		} else if (detailsTabButton.CheckCollision(mousePos)) {
-			if (selected.empty() || !mission->isMenuOpen()) {
-				auto it = std::find_if(BEGEND(roster), [&](const std::string& hero_name){ return getRef(hero_name).skillPoints > 0; });
+			if (!selected.valid() || !mission->isMenuOpen()) {
+				auto it = std::find_if(BEGEND(roster), [&](HeroId hero){ return getRef(hero).skillPoints > 0; });
 				if (it != roster.end()) selectHero(*it);
 				else selectHero(roster[0]);
 			}
@@ -155,16 +202,16 @@ bool HeroesHandler::handleInput() {
 				return true;
 			}
 		} else if (layoutHeroDetails.release.contains("backButton")) {
-			selectHero("");
+			selectHero({});
 			layoutHeroDetails.resetInput();
 			return true;
 		} else if (layoutHeroDetails.release.contains("stats-reset")) {
 			hero.resetAttributeChanges();
-			updateLayoutStatsData(layoutHeroDetails, hero);
+			updateLayoutStatsData(layoutHeroDetails, hero, shownAttrVersion);
 			return true;
 		} else if (layoutHeroDetails.release.contains("stats-confirm")) {
 			hero.applyAttributeChanges();
-			updateLayoutStatsData(layoutHeroDetails, hero);
+			updateLayoutStatsData(layoutHeroDetails, hero, shownAttrVersion);
 			return true;
 		} else {
 			for (auto attr : Attribute::Values) {
@@ -176,14 +223,14 @@ bool HeroesHandler::handleInput() {
 						hero.unconfirmed_attributes[attr]--;
 						hero.skillPoints++;
 					}
-					updateLayoutStatsData(layoutHeroDetails, hero);
+					updateLayoutStatsData(layoutHeroDetails, hero, shownAttrVersion);
 					return true;
 				} else if (layoutHeroDetails.release.contains(plus)) {
 					if (hero.skillPoints > 0) {
 						hero.unconfirmed_attributes[attr]++;
 						hero.skillPoints--;
 					}
-					updateLayoutStatsData(layoutHeroDetails, hero);
+					updateLayoutStatsData(layoutHeroDetails, hero, shownAttrVersion);
 					return true;
 				}
 			}
@@ -192,16 +239,43 @@ bool HeroesHandler::handleInput() {
 	return false;
 }
 
-void HeroesHandler::update(float deltaTime) {
-	for (auto& hero_name : roster) getRef(hero_name).update(deltaTime);
+void HeroesHandler::move(float deltaTime) {
+	// Travel speed comes from the attributes, which may get recomputed and emit events
+	for (HeroId hero : roster) if (store.moving(hero.index)) store.speed[hero.index] = getRef(hero).travelSpeed();
+
+	// Movement and timers only write to each hero's own store slots, so chunks of the roster advance on the pool
+	due.resize(roster.size());
+	WorkerPool::inst().parallelFor(roster.size(), 256, [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; i++) due[i] = store.advance(roster[i].index, deltaTime);
+	});
+}
+// Arrivals reach into missions and the map, they are applied serially in roster order. A timer in between may have sent
+// the hero off again, planRoute then started it over on a new route.
+void HeroesHandler::applyArrivals() {
+	for (size_t i = 0; i < std::min(due.size(), roster.size()); i++) {
+		if (!due[i]) continue;
+		due[i] = 0;
+		uint32_t index = roster[i].index;
+		if (store.moving(index) && store.travelled[index] >= store.route[index].length()) getRef(roster[i]).arrive();
+	}
+}
+
+// Seconds until the first moving hero reaches the end of its route, infinity when nobody is moving
+float HeroesHandler::nextArrival() {
+	float next = std::numeric_limits<float>::infinity();
+	for (HeroId hero : roster) if (store.moving(hero.index)) {
+		float speed = getRef(hero).travelSpeed();
+		if (speed > 0.0f) next = std::min(next, (store.route[hero.index].length() - store.travelled[hero.index]) / speed);
+	}
+	return std::max(next, 0.0f);
 }
 
-void HeroesHandler::selectHero(const std::string& name) {
-	selected = name;
+void HeroesHandler::selectHero(HeroId id) {
+	selected = id;
 
 	if (paused()) {
 		Hero& hero = getRef(selected);
-		const AttrMap<int>& attrs = hero.attributes();
+		hero.attributes();
 		std::vector<std::string> powerNames;
 		for (auto& power : hero.powers) {
 			powerNames.push_back(power.name);
@@ -215,7 +289,7 @@ void HeroesHandler::selectHero(const std::string& name) {
 		layoutHeroDetails.updateSharedData("powerNames", powerNames);
 		layoutHeroDetails.updateSharedData("full-image-key", std::format("hero-{}-full", hero.name));
 		layoutHeroDetails.updateSharedData("mugshot-image-key", std::format("hero-{}-mugshot", hero.name));
-		updateLayoutStatsData(layoutHeroDetails, hero);
+		updateLayoutStatsData(layoutHeroDetails, hero, shownAttrVersion);
 	}
 }
 
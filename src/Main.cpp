@@ -1,3 +1,4 @@
+#ifndef HEADLESS_BUILD
 #include <raylib-cpp.hpp>
 #include <nlohmann/json.hpp>
 #include <iostream>
@@ -14,6 +15,9 @@
 #include <Power.hpp>
 #include <Effect.hpp>
 #include <Event.hpp>
+#include <EventHandler.hpp>
+#include <TimerWheel.hpp>
+#include <Dispatcher.hpp>
 
 using nlohmann::json;
 
@@ -22,6 +26,7 @@ raylib::Window window(GetScreenWidth(), GetScreenHeight(), "raylib-cpp - basic w
 #else // DEBUG_BUILD
 raylib::Window window(960, 540, "raylib-cpp - basic window"); float bgScale;
 #endif
+raylib::Vector2 screenSize{(float)window.GetWidth(), (float)window.GetHeight()};
 
 int main() {
 	AttachConsole();
@@ -34,6 +39,8 @@ int main() {
 		MissionsHandler& missionsHandler = MissionsHandler::inst();
 		TextureManager& textureManager = TextureManager::inst();
 		CityMap& cityMap = CityMap::inst();
+		TimerWheel& timerWheel = TimerWheel::inst();
+		Dispatcher& dispatcher = Dispatcher::inst();
 		std::string paused = "";
 
 		// CRT Monitor Shader
@@ -63,10 +70,16 @@ int main() {
 			if (paused != "hero" && !handled) missionsHandler.handleInput();
 
 			if (paused == "") {
+				// Heroes walk before the timers run and arrive after them, like Headless steps
+				heroesHandler.move(deltaTime);
+				timerWheel.advance(deltaTime);
 				cityMap.update(deltaTime);
-				heroesHandler.update(deltaTime);
+				heroesHandler.applyArrivals();
 				missionsHandler.update(deltaTime);
+				// Suggestions are planned a slice per frame, opening a mission only reads the last plan
+				dispatcher.step();
 			}
+			EventHandler::inst().flush();
 			float t = GetTime();
 			crtShader.SetValue(crtTimeLoc, &t, SHADER_UNIFORM_FLOAT);
 			cloudShader.SetValue(cloudsTimeLoc, &t, SHADER_UNIFORM_FLOAT);
@@ -77,19 +90,19 @@ int main() {
 				std::cout << "mousePos: " << mousePos.x << "," << mousePos.y << std::endl;
 				std::cout << "paused: " << paused << std::endl;
 				std::cout << "heroes:" << std::endl;
-				for (auto& heroName : heroesHandler.roster) {
-					auto& hero = heroesHandler[heroName];
-					std::cout << "	" << heroName << ": " << json{hero.status} << std::endl;
+				for (HeroId heroId : heroesHandler.roster) {
+					auto& hero = heroesHandler[heroId];
+					std::cout << "	" << hero.name << ": " << json{hero.status()} << std::endl;
 				}
 				std::cout << "active missions:" << std::endl;
-				for (auto& missionName : missionsHandler.active) {
-					auto& mission = missionsHandler[missionName];
-					std::cout << "	" << missionName << ": " << json{mission.status} << std::endl;
+				for (MissionId missionId : missionsHandler.active) {
+					auto& mission = missionsHandler[missionId];
+					std::cout << "	" << mission.name << ": " << json{mission.status} << std::endl;
 				}
 				std::cout << "previous missions:" << std::endl;
-				for (auto& missionName : missionsHandler.previous) {
-					auto& mission = missionsHandler[missionName];
-					std::cout << "	" << missionName << ": " << json{mission.status} << std::endl;
+				for (MissionId missionId : missionsHandler.previous) {
+					auto& mission = missionsHandler[missionId];
+					std::cout << "	" << mission.name << ": " << json{mission.status} << std::endl;
 				}
 			}
 			#endif
@@ -137,8 +150,8 @@ int main() {
 			EndDrawing();
 		}
 
-		missionsHandler.missions.clear();
-		heroesHandler.heroes.clear();
+		missionsHandler.clear();
+		heroesHandler.clear();
 		textureManager.clear();
 	} catch (const std::exception& e) {
 		std::cerr << e.what() << std::endl;
@@ -147,3 +160,4 @@ int main() {
 
 	return 0;
 }
+#endif // HEADLESS_BUILD
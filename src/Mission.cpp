@@ -15,6 +15,8 @@ using nlohmann::json;
 #include <MissionsHandler.hpp>
 #include <HeroesHandler.hpp>
 #include <EventHandler.hpp>
+#include <Dispatcher.hpp>
+#include <OutcomeSimulator.hpp>
 
 Mission::Mission(
 	const std::string& new_name,
@@ -60,9 +62,14 @@ Mission::Mission(
 		requiredAttributes[attribute] = value;
 	}
 	assignedSlots.resize(slots);
+	updateTeamChance();
 };
 
-Mission::Mission(const json& data) { from_json(data, *this); validate(); }
+Mission::Mission(const json& data) {
+	from_json(data, *this);
+	validate();
+	updateTeamChance();
+}
 
 void Mission::validate() const {
 	if (name.empty()) throw std::invalid_argument("Mission name cannot be empty");
@@ -77,6 +84,7 @@ void Mission::validate() const {
 	if (!successMission.empty() && successMissionTime<=0.0f) throw std::invalid_argument("Mission 'successMissionTime' must be > 0 when success mission is set");
 	if (slots <= 0 || slots > 4) throw std::invalid_argument("Mission slots must be between 1 and 4");
 	if (difficulty < 1 || difficulty > 5) throw std::invalid_argument("Mission difficulty must be between 1 and 5");
+	if (weight < 0) throw std::invalid_argument("Mission weight cannot be negative");
 	if (failureTime < 1) throw std::invalid_argument("Mission failure time must be positive");
 	if (failureTime > 1000) throw std::invalid_argument("Mission failure time must be less than 1000 seconds");
 	if (missionDuration < 1) throw std::invalid_argument("Mission duration must be positive");
@@ -87,40 +95,47 @@ void Mission::validate() const {
 }
 
 
-void Mission::toggleHero(const std::string& hero_name) {
-	bool assigned = assignedHeroes.contains(hero_name);
-	if (assigned) unassignHero(hero_name);
-	else assignHero(hero_name);
+bool Mission::isAssigned(HeroId hero) const { return std::find(BEGEND(assignedHeroes), hero) != assignedHeroes.end(); }
+
+void Mission::toggleHero(HeroId hero_id) {
+	if (isAssigned(hero_id)) unassignHero(hero_id);
+	else assignHero(hero_id);
 }
 
-void Mission::assignHero(const std::string& hero_name) {
-	auto& hero = HeroesHandler::inst()[hero_name];
+void Mission::assignHero(HeroId hero_id) {
+	auto& hero = HeroesHandler::inst()[hero_id];
 	int cnt = (int)(assignedHeroes.size());
-	if (cnt < slots && hero.status == Hero::AVAILABLE) {
-		assignedHeroes.insert(hero_name);
+	if (cnt < slots && hero.status() == Hero::AVAILABLE) {
+		assignedHeroes.push_back(hero_id);
+		teamCapabilities |= hero.capabilities;
 		for (int i = 0; i < slots; i++) {
-			if (assignedSlots[i].empty()) {
-				assignedSlots[i] = hero_name;
+			if (!assignedSlots[i].valid()) {
+				assignedSlots[i] = hero_id;
 				break;
 			}
 		}
-		hero.changeStatus(Hero::ASSIGNED, name);
+		hero.changeStatus(Hero::ASSIGNED, id);
+		addToTeam(hero_id);
 	}
 	auto& layout = MissionsHandler::inst().layoutMissionDetails;
 	updateLayout(layout, "assignedHeroes");
 }
 
-void Mission::unassignHero(const std::string& hero_name) {
-	auto& hero = HeroesHandler::inst()[hero_name];
-	if (assignedHeroes.contains(hero_name)) {
-		assignedHeroes.erase(hero_name);
+void Mission::unassignHero(HeroId hero_id) {
+	auto& hero = HeroesHandler::inst()[hero_id];
+	if (isAssigned(hero_id)) {
+		std::erase(assignedHeroes, hero_id);
+		// A union cannot drop one member's bits, so it is rebuilt from the remaining team
+		teamCapabilities = Capability::NONE;
+		for (HeroId mate : assignedHeroes) teamCapabilities |= HeroesHandler::inst()[mate].capabilities;
 		for (int i = 0; i < slots; i++) {
-			if (assignedSlots[i] == hero_name) {
-				assignedSlots[i].clear();
+			if (assignedSlots[i] == hero_id) {
+				assignedSlots[i] = {};
 				break;
 			}
 		}
 		hero.changeStatus(Hero::AVAILABLE, {}, 0.0f);
+		removeFromTeam(hero_id);
 	}
 	auto& layout = MissionsHandler::inst().layoutMissionDetails;
 	updateLayout(layout, "assignedHeroes");
@@ -129,18 +144,20 @@ void Mission::unassignHero(const std::string& hero_name) {
 void Mission::changeStatus(Status newStatus) {
 	auto& eh = EventHandler::inst();
 	Status oldStatus = status;
+	stopClock();
 	status = newStatus;
 	if (newStatus != Mission::PENDING && newStatus != Mission::SELECTED && newStatus != Mission::DISRUPTION && oldStatus != Mission::DISRUPTION) timeElapsed = 0.0f;
 
 	if (oldStatus == Mission::PENDING && newStatus == Mission::SELECTED) {}
 	else if (oldStatus == Mission::SELECTED && newStatus == Mission::PENDING) {
-		for (auto& hero_name : assignedHeroes) HeroesHandler::inst()[hero_name].changeStatus(Hero::AVAILABLE, {}, 0.0f);
+		for (HeroId hero : assignedHeroes) HeroesHandler::inst()[hero].changeStatus(Hero::AVAILABLE, {}, 0.0f);
 		assignedHeroes.clear();
-		for (auto& slot : assignedSlots) if (!slot.empty()) slot.clear();
+		clearTeam();
+		teamCapabilities = Capability::NONE;
+		for (auto& slot : assignedSlots) slot = {};
 	} else if (oldStatus == Mission::SELECTED && newStatus == Mission::TRAVELLING) {
-		EventData ed = MissionStartData{name, &assignedSlots};
-		eh.emit<Event::MissionStart>(assignedHeroes, name, &assignedSlots);
-		for (auto hero_name : assignedHeroes) HeroesHandler::inst()[hero_name].changeStatus(Hero::TRAVELLING);
+		eh.emit<Event::MissionStart>(assignedHeroes, id, &assignedSlots);
+		for (HeroId hero : assignedHeroes) HeroesHandler::inst()[hero].changeStatus(Hero::TRAVELLING);
 	} else if (oldStatus == Mission::TRAVELLING && newStatus == Mission::PROGRESS) {
 	} else if (oldStatus == Mission::PROGRESS && newStatus == Mission::DISRUPTION) {
 		curDisruption++;
@@ -149,19 +166,20 @@ void Mission::changeStatus(Status newStatus) {
 		auto& disruption = disruptions[curDisruption];
 		for (auto& option : disruption.options) {
 			if (option.type == Disruption::Option::HERO) {
-				option.disabled = !std::any_of(BEGEND(assignedHeroes), [&](auto& hero_name){ return hero_name == option.hero; });
+				option.disabled = !std::any_of(BEGEND(assignedHeroes), [&](HeroId hero){ return HeroesHandler::inst()[hero].name == option.hero; });
 			} else option.disabled = false;
 		}
 	} else if (oldStatus == Mission::DISRUPTION && newStatus == Mission::PROGRESS) {
 		disrupted = true;
 		curDisruption = disruptions.size();
 	} else if (oldStatus == Mission::PROGRESS && newStatus == Mission::AWAITING_REVIEW) {
-		if (isSuccessful()) success = true;
+		// The roll the success chance in the details panel, the Dispatcher and the OutcomeSimulator stand for
+		success = isSuccessful();
 		finalAttributes = getTotalAttributes();
-		for (auto& hero_name : assignedHeroes) HeroesHandler::inst()[hero_name].changeStatus(Hero::RETURNING);
+		for (HeroId hero : assignedHeroes) HeroesHandler::inst()[hero].changeStatus(Hero::RETURNING);
 	} else if (oldStatus == Mission::AWAITING_REVIEW && newStatus == Mission::REVIEWING) {
-		if (success) eh.emit<Event::MissionSuccess>(assignedHeroes, name, &assignedSlots);
-		else eh.emit<Event::MissionFailure>(assignedHeroes, name, &assignedSlots);
+		if (success) eh.emit<Event::MissionSuccess>(assignedHeroes, id, &assignedSlots);
+		else eh.emit<Event::MissionFailure>(assignedHeroes, id, &assignedSlots);
 		Utils::println("Mission {} completed, it was a {}", name, success ? "success" : "failure");
 	} else if (newStatus == Mission::DONE || newStatus == Mission::MISSED) {
 		if (success && !disrupted) {
@@ -170,63 +188,100 @@ void Mission::changeStatus(Status newStatus) {
 			float difficultyMult = std::sqrt(difficulty);
 			float heroCountDiv = std::sqrt(assignedHeroes.size());
 			int exp = 500 * chanceMult * difficultyMult / heroCountDiv;
-			for (auto& hero_name : assignedHeroes) HeroesHandler::inst()[hero_name].addExp(exp);
+			for (HeroId hero : assignedHeroes) HeroesHandler::inst()[hero].addExp(exp);
 			Utils::println("Each hero gained {} exp", exp);
 			if (!successMission.empty()) MissionsHandler::inst().addMissionToQueue(successMission, successMissionTime);
 		} else if ((!success || disrupted) && dangerous) {
-			auto& hero_name = Utils::random_element(assignedHeroes);
-			auto& hero = HeroesHandler::inst()[hero_name];
+			auto& hero = HeroesHandler::inst()[Utils::random_element(assignedHeroes)];
 			hero.wound();
 			Utils::println("{} was wounded", hero.name);
 			if (!failureMission.empty()) MissionsHandler::inst().addMissionToQueue(failureMission, failureMissionTime);
 		}
-		for (auto& hero_name : assignedHeroes) {
-			auto& hero = HeroesHandler::inst()[hero_name];
-			if (hero.status == Hero::AWAITING_REVIEW) hero.changeStatus(Hero::AVAILABLE, {}, 0.0f);
-			else if (hero.status == Hero::WORKING) hero.changeStatus(Hero::RETURNING, {}, 0.0f);
-			else hero.mission.clear();
+		for (HeroId hero_id : assignedHeroes) {
+			auto& hero = HeroesHandler::inst()[hero_id];
+			if (hero.status() == Hero::AWAITING_REVIEW) hero.changeStatus(Hero::AVAILABLE, {}, 0.0f);
+			else if (hero.status() == Hero::WORKING) hero.changeStatus(Hero::RETURNING, {}, 0.0f);
+			else hero.setMission({});
 		}
+		MissionsHandler::inst().finished.push_back(id);
 	} else {
 		Utils::println("Invalid mission status change, from {} to {}", statusToString(oldStatus), statusToString(newStatus));
 		throw std::invalid_argument(std::format("Invalid mission status change, from {} to {}", statusToString(oldStatus), statusToString(newStatus)));
 	}
+	startClock();
 
 	auto& layout = MissionsHandler::inst().layoutMissionDetails;
 	updateLayout(layout, "status");
 }
 
-void Mission::update(float deltaTime) {
-	int working = std::count_if(BEGEND(assignedHeroes), [&](auto& hero_name){ return HeroesHandler::inst()[hero_name].status == Hero::WORKING; });
+float Mission::elapsed() const { return timeElapsed + (float)(TimerWheel::inst().now() - clockSince) * clockRate; }
+float Mission::disruptionElapsed() const {
+	auto& disruption = disruptions[curDisruption];
+	return disruption.elapsedTime + (status == Mission::DISRUPTION ? (float)(TimerWheel::inst().now() - clockSince) : 0.0f);
+}
+float Mission::nextDisruptionTime() const {
+	int sz = static_cast<int>(disruptions.size());
+	if (sz == 0 || curDisruption >= sz) return missionDuration;
+	return (curDisruption + 2) * missionDuration / (1 + sz);
+}
+
+// Folds the time run so far into timeElapsed (and the disruption's) and stops the clock
+void Mission::stopClock() {
+	auto& wheel = TimerWheel::inst();
+	timeElapsed = elapsed();
+	if (status == Mission::DISRUPTION) disruptions[curDisruption].elapsedTime = disruptionElapsed();
+	clockSince = wheel.now();
+	clockRate = 0.0f;
+	wheel.cancel(timer);
+}
+// Runs the clock at the rate of the current status and schedules the deadline it runs into next
+void Mission::startClock() {
+	auto& wheel = TimerWheel::inst();
+	wheel.cancel(timer);
+	float deadline = 0.0f;
 	switch (status) {
 		case Mission::PENDING:
-			timeElapsed += deltaTime;
-			if (timeElapsed >= failureTime) changeStatus(Mission::MISSED);
-			break;
-		case Mission::TRAVELLING:
-			if (working > 0) changeStatus(Mission::PROGRESS);
+			clockRate = 1.0f;
+			deadline = failureTime;
 			break;
 		case Mission::PROGRESS: {
-			timeElapsed += deltaTime * working / assignedHeroes.size();
-			int sz = static_cast<int>(disruptions.size());
-			if (sz > 0 && curDisruption < sz) {
-				float disruptionInterval = missionDuration / (1 + sz);
-				float disruptionTime = (curDisruption + 2) * disruptionInterval;
-				if (timeElapsed >= disruptionTime) changeStatus(Mission::DISRUPTION);
-			}
-			if (timeElapsed >= missionDuration) changeStatus(Mission::AWAITING_REVIEW);
+			int working = std::count_if(BEGEND(assignedHeroes), [&](HeroId hero){ return HeroesHandler::inst()[hero].status() == Hero::WORKING; });
+			clockRate = assignedHeroes.empty() ? 0.0f : (float)working / assignedHeroes.size();
+			deadline = nextDisruptionTime();
 			break;
 		} case Mission::DISRUPTION: {
 			auto& disruption = disruptions[curDisruption];
-			disruption.elapsedTime += deltaTime;
-			if (disruption.elapsedTime >= disruption.timeout) changeStatus(Mission::PROGRESS);
+			timer = wheel.schedule(disruption.timeout - disruption.elapsedTime, [mission = id]{ MissionsHandler::inst()[mission].expire(); });
+			return;
+		} default:
+			return;
+	}
+	if (clockRate > 0.0f) timer = wheel.schedule((deadline - timeElapsed) / clockRate, [mission = id]{ MissionsHandler::inst()[mission].expire(); });
+}
+void Mission::updateClock() {
+	stopClock();
+	startClock();
+}
+
+// Mission timer callback, the clock is snapped to the deadline so rounding cannot leave it just short
+void Mission::expire() {
+	timer = {};
+	switch (status) {
+		case Mission::PENDING:
+			stopClock();
+			timeElapsed = failureTime;
+			changeStatus(Mission::MISSED);
 			break;
-		} case Mission::SELECTED:
-		case Mission::AWAITING_REVIEW:
-		case Mission::REVIEWING:
-		case Mission::DISRUPTION_MENU:
+		case Mission::PROGRESS: {
+			float deadline = nextDisruptionTime();
+			stopClock();
+			timeElapsed = deadline;
+			changeStatus(deadline < missionDuration ? Mission::DISRUPTION : Mission::AWAITING_REVIEW);
+			break;
+		} case Mission::DISRUPTION:
+			changeStatus(Mission::PROGRESS);
 			break;
 		default:
-			timeElapsed += deltaTime;
 			break;
 	}
 }
@@ -238,17 +293,17 @@ void Mission::renderUI() {
 	raylib::Color textColor{RED}, backgroundColor{ORANGE}, timeRemainingColor{LIGHTGRAY}, timeElapsedColor{GRAY};
 	switch (status) {
 		case Mission::PENDING:
-			progress = timeElapsed / failureTime;
+			progress = elapsed() / failureTime;
 			break;
 		case Mission::SELECTED:
-			progress = timeElapsed / failureTime;
+			progress = elapsed() / failureTime;
 			textColor = WHITE;
 			backgroundColor = SKYBLUE;
 			timeElapsedColor = BLUE;
 			timeRemainingColor = WHITE;
 			break;
 		case Mission::PROGRESS:
-			progress = timeElapsed / missionDuration;
+			progress = elapsed() / missionDuration;
 			// fallthrough
 		case Mission::TRAVELLING:
 			text = "🏃";
@@ -273,7 +328,7 @@ void Mission::renderUI() {
 			backgroundColor = RED;
 			timeRemainingColor = WHITE;
 			timeElapsedColor = RED;
-			progress = disruptions[curDisruption].elapsedTime / disruptions[curDisruption].timeout;
+			progress = disruptionElapsed() / disruptions[curDisruption].timeout;
 			break;
 		default:
 			textColor = LIGHTGRAY;
@@ -300,10 +355,10 @@ void Mission::handleInput() {
 				layout.resetInput();
 			} else {
 				for (int i = 0; i < slots; i++) {
-					auto& heroName = assignedSlots[i];
-					if (!heroName.empty()) {
-						std::string s_key = std::format("slots.children.{}-{}", i, heroName);
-						if (layout.clicked.contains(s_key)) unassignHero(heroName);
+					HeroId hero = assignedSlots[i];
+					if (hero.valid()) {
+						std::string s_key = std::format("slots.children.{}-{}", i, HeroesHandler::inst()[hero].name);
+						if (layout.clicked.contains(s_key)) unassignHero(hero);
 					}
 				}
 			}
@@ -344,8 +399,7 @@ void Mission::handleInput() {
 }
 
 void Mission::setupLayout(Dispatch::UI::Layout& layout) {
-	AttrMap<int> overlap;
-	for (Attribute::Value attr : Attribute::Values) overlap[attr] = std::min(requiredAttributes[attr], finalAttributes[attr]);
+	AttrMap<int> overlap = requiredAttributes.min(finalAttributes);
 	layout.updateSharedData("type", type);
 	layout.updateSharedData("caller", caller);
 	layout.updateSharedData("description", description);
@@ -354,6 +408,10 @@ void Mission::setupLayout(Dispatch::UI::Layout& layout) {
 	layout.updateSharedData("required-attributes", requiredAttributes);
 	layout.updateSharedData("overlap-attributes", overlap);
 	layout.updateSharedData("success-chance", std::format("{}%", getSuccessChance())); // TODO: Add icon "🎯"
+	std::vector<std::string> suggested;
+	const auto* suggestion = Dispatcher::inst().suggestion(id);
+	if (suggestion) for (HeroId hero : suggestion->slots) if (hero.valid()) suggested.push_back(HeroesHandler::inst()[hero].name);
+	layout.updateSharedData("suggestion", suggestion ? std::format("Suggested: {} ({}%)", Utils::join(suggested, ", "), suggestion->chance) : std::string{});
 	layout.updateSharedData("review-message", status == success ? successMsg : failureMsg);
 
 	updateLayout(layout, "");
@@ -362,7 +420,7 @@ void Mission::updateLayout(Dispatch::UI::Layout& layout, const std::string& chan
 	if (changed == "assignedHeroes" || changed == "") {
 		std::vector<std::string> slotNames;
 		for (int i = 0; i < slots; i++) {
-			if (assignedSlots[i].empty()) {
+			if (!assignedSlots[i].valid()) {
 				std::string s_key = std::format("{}-empty", i);
 				slotNames.push_back(s_key);
 				layout.deleteSharedData(s_key + "-image-key");
@@ -378,6 +436,23 @@ void Mission::updateLayout(Dispatch::UI::Layout& layout, const std::string& chan
 		layout.updateSharedData("slot-names", slotNames);
 		if (status == Status::REVIEWING) layout.updateSharedData("total-attributes", finalAttributes);
 		else layout.updateSharedData("total-attributes", getTotalAttributes());
+		// The outcome and best fits are only worked out for the mission the details panel shows, not for teams assigned elsewhere
+		if (MissionsHandler::inst().selected == id) {
+			std::string outcome;
+			if (status == Status::SELECTED && !assignedHeroes.empty()) {
+				auto result = OutcomeSimulator::simulate(id, assignedSlots);
+				outcome = std::format("Success {:.0f}%, wounds {:.0f}%", result.success * 100, result.anyWound * 100);
+				if (!result.followUps.empty()) outcome += std::format(", then {} {:.0f}%", MissionsHandler::inst()[result.followUps[0].first].name, result.followUps[0].second * 100);
+			}
+			layout.updateSharedData("outcome", outcome);
+			std::vector<std::string> fits;
+			if (status == Status::SELECTED && assignedHeroes.size() < (size_t)slots) {
+				auto& hh = HeroesHandler::inst();
+				int requiredTotal = requiredAttributes.sum();
+				for (auto [hero, score] : hh.available().best(requiredAttributes, 3)) fits.push_back(std::format("{} {}%", hh[hero].name, requiredTotal ? score * 100 / requiredTotal : 100));
+			}
+			layout.updateSharedData("recommended", fits.empty() ? std::string{} : "Best fits: " + Utils::join(fits, ", "));
+		}
 
 		auto* dispatch = layout.get<Dispatch::UI::Button>("dispatch");
 		if (!dispatch) throw std::runtime_error("Mission details layout is missing 'dispatch' element or it is of the wrong type.");
@@ -454,41 +529,64 @@ void Mission::updateLayout(Dispatch::UI::Layout& layout, const std::string& chan
 	}
 }
 
-AttrMap<int> Mission::getTotalAttributes() const {
-	AttrMap<int> totalAttributes;
-	for (const auto& hero_name : assignedHeroes) for (const auto& [attr, value] : HeroesHandler::inst()[hero_name].attributes()) totalAttributes[attr] += value;
-	return totalAttributes;
+void Mission::addToTeam(HeroId hero) {
+	auto snapshot = HeroesHandler::inst()[hero].attrSnapshot();
+	team.push_back({hero, snapshot.version, snapshot.values});
+	teamAttributes += snapshot.values;
+	updateTeamChance();
 }
-int Mission::getTotalAttribute(Attribute attr) const {
-	int total = 0;
-	for (const auto& hero_name : assignedHeroes) total += HeroesHandler::inst()[hero_name].attributes()[attr];
-	return total;
+void Mission::removeFromTeam(HeroId hero) {
+	auto it = std::find_if(BEGEND(team), [&](const TeamMember& member) { return member.hero == hero; });
+	if (it == team.end()) return;
+	teamAttributes -= it->values;
+	team.erase(it);
+	updateTeamChance();
 }
-
-int Mission::getSuccessChance() const {
-	if (disrupted) return 0;
-
-	AttrMap<int> totalAttributes = getTotalAttributes();
-	int total = 0;
-	int requiredTotal = 0;
-
-	for (const auto& [attr, requiredValue] : requiredAttributes) {
-		int heroValue = totalAttributes[attr];
-		total += std::min(heroValue, requiredValue);
-		requiredTotal += requiredValue;
+void Mission::clearTeam() {
+	team.clear();
+	teamAttributes = {};
+	updateTeamChance();
+}
+// Teammates' bonuses, wounds and effects all show up as a new snapshot version, anything else is left as counted
+void Mission::refreshTeam() {
+	if (teamChecked == Hero::attrInvalidations) return;
+	teamChecked = Hero::attrInvalidations;
+	bool changed = false;
+	for (auto& member : team) {
+		auto snapshot = HeroesHandler::inst()[member.hero].attrSnapshot();
+		if (snapshot.version == member.version) continue;
+		teamAttributes -= member.values;
+		teamAttributes += snapshot.values;
+		member.values = snapshot.values;
+		member.version = snapshot.version;
+		changed = true;
 	}
+	if (changed) updateTeamChance();
+}
+void Mission::updateTeamChance() {
+	int requiredTotal = requiredAttributes.sum();
+	teamChance = requiredTotal == 0 ? 100 : teamAttributes.min(requiredAttributes).sum() * 100 / requiredTotal;
+}
+
+const AttrMap<int>& Mission::getTotalAttributes() {
+	refreshTeam();
+	return teamAttributes;
+}
+int Mission::getTotalAttribute(Attribute attr) { return getTotalAttributes()[attr]; }
 
-	if (requiredTotal == 0) return 100;
-	return total * 100 / requiredTotal;
+int Mission::getSuccessChance() {
+	if (disrupted) return 0;
+	refreshTeam();
+	return teamChance;
 }
 
-bool Mission::isSuccessful() const {
+bool Mission::isSuccessful() {
 	int chance = getSuccessChance();
 	int roll = (rand() % 100) + 1;
 	return roll <= chance;
 }
 
-bool Mission::isDisruptionSuccessful() const {
+bool Mission::isDisruptionSuccessful() {
 	if (curDisruption < 0 || curDisruption > (int)disruptions.size()) return true;
 	const auto& disruption = disruptions[curDisruption];
 	if (disruption.selected_option == -1) return false;
@@ -545,6 +643,7 @@ void Mission::to_json(nlohmann::json& j, const Mission& inst) {
 		WRITE(requiredAttributes),
 		WRITE(slots),
 		WRITE(difficulty),
+		WRITE(weight),
 		// WRITE(curDisruption),
 		// WRITE(timeElapsed),
 		WRITE(dangerous),
@@ -580,6 +679,7 @@ void Mission::from_json(const nlohmann::json& j, Mission& inst) {
 	READREQ2(j, requiredAttributes, attributes);
 	READREQ(j, slots);
 	READREQ(j, difficulty);
+	READ(j, weight);
 	// READ(j, curDisruption);
 	// READ(j, timeElapsed);
 	READ(j, dangerous);
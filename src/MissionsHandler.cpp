@@ -1,5 +1,6 @@
 #include <exception>
 #include <algorithm>
+#include <limits>
 #include <memory>
 #include <format>
 #include <fstream>
@@ -14,6 +15,7 @@ using nlohmann::json;
 MissionsHandler::MissionsHandler() {
 	auto missionFiles = Utils::getFilesInFolder("resources/data/missions", ".json");
 	for (auto& path : missionFiles) loadMissions(path);
+	updateSpawnClock();
 }
 
 MissionsHandler& MissionsHandler::inst() {
@@ -28,28 +30,64 @@ void MissionsHandler::loadMissions(const std::string& file) {
 	if (!missions_array.is_array()) throw std::runtime_error("Heroes error: Top-level JSON must be an array of heroes.");
 	Utils::println("Read {} missions", missions_array.size());
 	for (auto& data : missions_array) {
-		auto ms = std::make_unique<Mission>(data);
-		// Utils::println("Loaded {}mission '{}'", ms->triggered ? "triggered " : "", ms->name);
-		if (ms->triggered) trigger.insert(ms->name);
-		else loaded.insert(ms->name);
-		missions[ms->name] = std::move(ms);
+		MissionId id = addMission(std::make_unique<Mission>(data));
+		auto& ms = getRef(id);
+		// Utils::println("Loaded {}mission '{}'", ms.triggered ? "triggered " : "", ms.name);
+		if (ms.triggered) trigger.insert(id);
+		else loaded.insert(id, spawnWeight(ms));
 	}
 }
+MissionId MissionsHandler::addMission(std::unique_ptr<Mission> mission) {
+	auto [it, inserted] = ids.try_emplace(mission->name, MissionId{(uint32_t)missions.size()});
+	mission->id = it->second;
+	if (inserted) missions.push_back(std::move(mission));
+	else {
+		TimerWheel::inst().cancel(missions[it->second.index]->timer);
+		missions[it->second.index] = std::move(mission);
+		loaded.setWeight(it->second, spawnWeight(*missions[it->second.index]));
+	}
+	return it->second;
+}
+void MissionsHandler::clear() {
+	auto& wheel = TimerWheel::inst();
+	for (auto& mission : missions) wheel.cancel(mission->timer);
+	selected = {};
+	trigger.clear(); loaded.clear(); active.clear(); previous.clear();
+	mission_queue.clear();
+	finished.clear();
+	ids.clear();
+	missions.clear();
+	timeToNext = 1.0f;
+	spawnRate = 0.0f;
+	updateSpawnClock();
+}
+void MissionsHandler::reweight() {
+	for (MissionId id : loaded) loaded.setWeight(id, spawnWeight(getRef(id)));
+}
 Mission& MissionsHandler::activateMission() {
-	if (loaded.empty()) return createRandomMission();
-	auto& name = Utils::random_element(loaded);
-	return activateMission(name);
+	if (loaded.empty() || loaded.total() <= 0.0) return createRandomMission();
+	return activateMission(loaded.pick(Utils::randDouble(0.0, 1.0)));
 }
-Mission& MissionsHandler::activateMission(const std::string& name) {
-	if (!missions.contains(name)) throw std::invalid_argument("Cannot activate mission that is not loaded");
-	if (active.contains(name)) throw std::invalid_argument("Cannot activate active mission");
-	if (previous.contains(name)) throw std::invalid_argument("Cannot activate completed mission");
-	auto& mission = getRef(name);
-	active.insert(name);
-	loaded.erase(name);
-	trigger.erase(name);
+Mission& MissionsHandler::activateMission(MissionId id) {
+	if (id.index >= missions.size()) throw std::invalid_argument("Cannot activate mission that is not loaded");
+	if (active.contains(id)) throw std::invalid_argument("Cannot activate active mission");
+	if (previous.contains(id)) throw std::invalid_argument("Cannot activate completed mission");
+	loaded.erase(id);
+	trigger.erase(id);
+	return activated(id);
+}
+Mission& MissionsHandler::activated(MissionId id) {
+	auto& mission = getRef(id);
+	active.insert(id);
+	mission.updateClock();
+	updateSpawnClock();
 	return mission;
 }
+Mission& MissionsHandler::activateMission(const std::string& name) {
+	auto it = ids.find(name);
+	if (it == ids.end()) throw std::invalid_argument("Cannot activate mission that is not loaded");
+	return activateMission(it->second);
+}
 Mission& MissionsHandler::createRandomMission(int difficulty, int slots) {
 	static int missionCount = 0;
 	difficulty = difficulty == -1 ? Utils::randInt(1, 5) : difficulty;
@@ -104,38 +142,40 @@ Mission& MissionsHandler::createRandomMission(int difficulty, int slots) {
 		// dangerous
 		(difficulty >= 3) ? true : ((rand()%5) < difficulty)
 	);
-	active.insert(name);
-	missions[name] = std::move(mission);
-	return *missions[name].get();
+	return activated(addMission(std::move(mission)));
 }
 
-const Mission* MissionsHandler::get(const std::string& name) const { return (missions.at(name).get()); }
-Mission* MissionsHandler::get(const std::string& name) { return (missions.at(name).get()); }
-const Mission& MissionsHandler::getRef(const std::string& name) const { return *get(name); }
-Mission& MissionsHandler::getRef(const std::string& name) { return *get(name); }
-const Mission& MissionsHandler::operator[](const std::string& name) const { return getRef(name); }
-Mission& MissionsHandler::operator[](const std::string& name) { return getRef(name); }
+const Mission* MissionsHandler::get(MissionId id) const { return (missions.at(id.index).get()); }
+Mission* MissionsHandler::get(MissionId id) { return (missions.at(id.index).get()); }
+const Mission& MissionsHandler::getRef(MissionId id) const { return *get(id); }
+Mission& MissionsHandler::getRef(MissionId id) { return *get(id); }
+MissionId MissionsHandler::id(const std::string& name) const { return ids.at(name); }
+const Mission& MissionsHandler::operator[](MissionId id) const { return getRef(id); }
+Mission& MissionsHandler::operator[](MissionId id) { return getRef(id); }
+const Mission& MissionsHandler::operator[](const std::string& name) const { return getRef(id(name)); }
+Mission& MissionsHandler::operator[](const std::string& name) { return getRef(id(name)); }
 Mission* MissionsHandler::selectedMission() { return paused() ? get(selected) : (Mission*)nullptr; }
 
-bool MissionsHandler::paused() const { return !selected.empty(); }
+bool MissionsHandler::paused() const { return selected.valid(); }
 
-void MissionsHandler::selectMission(const std::string& name) {
-	if (!active.count(name)) return;
-	selected = name;
-	getRef(name).setupLayout(layoutMissionDetails);
+void MissionsHandler::selectMission(MissionId id) {
+	if (!active.count(id)) return;
+	selected = id;
+	getRef(id).setupLayout(layoutMissionDetails);
 }
 
-void MissionsHandler::unselectMission() { selected.clear(); }
+void MissionsHandler::unselectMission() { selected = {}; }
 
-void MissionsHandler::addMissionToQueue(const std::string& name, float time) {
-	if (!missions.contains(name)) throw std::invalid_argument("Mission must be loaded");
+Schedule<MissionId>::Handle MissionsHandler::addMissionToQueue(const std::string& name, float time) {
+	auto it = ids.find(name);
+	if (it == ids.end()) throw std::invalid_argument("Mission must be loaded");
 	Utils::println("Mission {} scheduled in {} seconds", name, time);
-	mission_queue.emplace_back(name, time);
+	return mission_queue.push(TimerWheel::inst().now() + time, it->second);
 }
 
 
 void MissionsHandler::renderUI() {
-	for (auto& name : active) getRef(name).renderUI();
+	for (MissionId id : active) getRef(id).renderUI();
 	if (paused()) layoutMissionDetails.render();
 }
 
@@ -145,42 +185,49 @@ void MissionsHandler::handleInput() {
 		layoutMissionDetails.handleInput();
 		mission.handleInput();
 		if (!mission.isMenuOpen()) unselectMission();
-	} else for (auto& name : active) {
-		auto& mission = getRef(name);
+	} else for (MissionId id : active) {
+		auto& mission = getRef(id);
 		mission.handleInput();
 		if (mission.isMenuOpen()) {
-			selectMission(name);
+			selectMission(id);
 			break;
 		}
 	}
 }
 
-void MissionsHandler::update(float deltaTime) {
-	std::unordered_set<std::string> finished;
-
-	if (paused()) getRef(selected).update(deltaTime);
-	else for (auto& name : active) {
-		auto& mission = getRef(name);
-		mission.update(deltaTime);
-		if (mission.status == Mission::DONE || mission.status == Mission::MISSED) finished.insert(name);
-	}
-
-	for (auto& name : finished) {
-		active.erase(name);
-		previous.insert(name);
-	}
+// The spawn countdown is folded at the old rate before switching to the one for the current number of active missions
+void MissionsHandler::updateSpawnClock() {
+	auto& wheel = TimerWheel::inst();
+	timeToNext -= (float)(wheel.now() - spawnSince) * spawnRate;
+	spawnSince = wheel.now();
+	spawnRate = 1.0f / (1 + active.size());
+	wheel.cancel(spawnTimer);
+	spawnTimer = wheel.schedule(timeToNext / spawnRate, [this]{ spawn(); });
+}
+void MissionsHandler::spawn() {
+	spawnTimer = {};
+	timeToNext = 0.0f;
+	spawnSince = TimerWheel::inst().now();
+	activateMission();
+	timeToNext = rand() % 4 + rand() % 4 + 2;
+	updateSpawnClock();
+}
 
-	timeToNext -= deltaTime / (1 + active.size());
-	if (timeToNext <= 0) {
-		activateMission();
-		timeToNext = rand() % 4 + rand() % 4 + 2;
+// Mission deadlines and spawning run on the TimerWheel, what is left here is retiring finished missions and the queue
+void MissionsHandler::update(float) {
+	if (!finished.empty()) {
+		for (MissionId id : finished) {
+			active.erase(id);
+			previous.insert(id);
+		}
+		finished.clear();
+		updateSpawnClock();
 	}
 
-	for (int i = 0; i < (int)mission_queue.size(); i++) {
-		auto& [name, time] = mission_queue[i];
-		if (time < deltaTime) {
-			activateMission(name);
-			mission_queue.erase(mission_queue.begin()+i--);
-		} else time -= deltaTime;
-	}
+	double now = TimerWheel::inst().now();
+	while (mission_queue.nextTime() <= now) activateMission(mission_queue.pop());
+}
+// Seconds until the first queued mission activates, infinity when the queue is empty
+float MissionsHandler::nextQueued() const {
+	return (float)std::max(mission_queue.nextTime() - TimerWheel::inst().now(), 0.0);
 }
@@ -0,0 +1,188 @@
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <random>
+#include <stdexcept>
+
+#include <Utils.hpp>
+#include <OutcomeSimulator.hpp>
+#include <Attribute.hpp>
+#include <Effect.hpp>
+#include <Hero.hpp>
+#include <HeroesHandler.hpp>
+#include <Mission.hpp>
+#include <MissionsHandler.hpp>
+#include <WorkerPool.hpp>
+
+namespace {
+	constexpr int MAX_TEAM = 4, MAX_NODES = 64;
+	constexpr long CHUNK = 1024;
+
+	// How one mission goes for one combination of the team's health
+	struct Outcome {
+		int chance;
+		bool disrupted;
+	};
+	struct Node {
+		MissionId id;
+		bool dangerous;
+		int onSuccess = -1, onFailure = -1;
+		// Indexed by health code: each member's Hero::Health as a base 3 digit, in team order
+		std::vector<Outcome> outcomes;
+	};
+	struct Tally {
+		long success = 0, disrupted = 0, anyWound = 0;
+		std::array<long, MAX_TEAM> wounded{}, downed{};
+		std::array<long, MAX_NODES> reached{};
+	};
+
+	AttrMap<int> withHealth(AttrMap<int> values, Hero::Health from, Hero::Health to) {
+		if (to == from) return values;
+		for (Attribute::Value attr : Attribute::Values) {
+			if (to == Hero::DOWNED) values[attr] = 1;
+			else if (values[attr] > 1) values[attr]--;
+		}
+		return values;
+	}
+}
+
+OutcomeSimulator::Result OutcomeSimulator::simulate(MissionId root, const std::vector<HeroId>& team, const Options& options) {
+	if (options.trials <= 0 || options.depth <= 0) throw std::invalid_argument("OutcomeSimulator needs a positive number of trials and depth");
+	auto& hh = HeroesHandler::inst();
+	auto& mh = MissionsHandler::inst();
+
+	// Members with their attributes on this team, bonuses from teammates land by slot like Hero::updateAttrSources does
+	std::vector<int> slots;
+	for (int slot = 0; slot < (int)team.size(); slot++) if (team[slot].valid()) slots.push_back(slot);
+	int size = (int)slots.size();
+	if (size == 0) throw std::invalid_argument("OutcomeSimulator needs at least one hero");
+	if (size > MAX_TEAM) throw std::invalid_argument(std::format("OutcomeSimulator teams have at most {} heroes", MAX_TEAM));
+	std::array<AttrMap<int>, MAX_TEAM> attrs{};
+	std::array<Hero::Health, MAX_TEAM> health{};
+	for (int i = 0; i < size; i++) {
+		Hero& hero = hh[team[slots[i]]];
+		attrs[i] = hero.soloAttributes();
+		health[i] = hero.health;
+		for (int j = 0; j < size; j++) for (AttrBonusEffect* bonus : hh[team[slots[j]]].teamBonuses()) if (bonus->applies(slots[j], slots[i])) attrs[i] += bonus->bonus;
+	}
+	int codes = 1, start = 0;
+	std::array<int, MAX_TEAM> digit{};
+	for (int i = 0; i < size; i++) {
+		digit[i] = codes;
+		start += health[i] * codes;
+		codes *= 3;
+	}
+
+	// The chain, breadth first from the mission itself. Failure missions are only queued by dangerous missions.
+	std::vector<Node> nodes;
+	auto node = [&](const std::string& name) {
+		auto it = mh.ids.find(name);
+		if (name.empty() || it == mh.ids.end()) return -1;
+		auto found = std::find_if(BEGEND(nodes), [&](const Node& n) { return n.id == it->second; });
+		if (found != nodes.end()) return (int)(found - nodes.begin());
+		if ((int)nodes.size() == MAX_NODES) return -1;
+		nodes.push_back({it->second, false, -1, -1, {}});
+		return (int)nodes.size() - 1;
+	};
+	nodes.push_back({root, false, -1, -1, {}});
+	for (size_t index = 0; index < nodes.size(); index++) {
+		Mission& mission = mh[nodes[index].id];
+		int onSuccess = node(mission.successMission);
+		int onFailure = mission.dangerous ? node(mission.failureMission) : -1;
+		Node& current = nodes[index];
+		current.dangerous = mission.dangerous;
+		current.onSuccess = onSuccess;
+		current.onFailure = onFailure;
+		current.outcomes.resize(codes);
+		int requiredTotal = mission.requiredAttributes.sum();
+		// The mission clock fires the disruption after curDisruption and no other, a follow-up starts from the first
+		int fires = index == 0 ? mission.curDisruption + 1 : 0;
+		const Disruption* disruption = fires >= 0 && fires < (int)mission.disruptions.size() ? &mission.disruptions[fires] : nullptr;
+		bool already = index == 0 && mission.disrupted;
+		for (int code = 0; code < codes; code++) {
+			AttrMap<int> total{};
+			for (int i = 0; i < size; i++) total += withHealth(attrs[i], health[i], (Hero::Health)(code / digit[i] % 3));
+			bool disrupted = already;
+			if (disruption && !disrupted) disrupted = !options.answerDisruptions || std::none_of(BEGEND(disruption->options), [&](const Disruption::Option& option) {
+				if (option.type == Disruption::Option::HERO) return std::any_of(BEGEND(slots), [&](int slot) { return hh[team[slot]].name == option.hero; });
+				return total[Attribute{option.attribute}] >= option.value;
+			});
+			int chance = requiredTotal == 0 ? 100 : total.min(mission.requiredAttributes).sum() * 100 / requiredTotal;
+			current.outcomes[code] = {disrupted ? 0 : chance, disrupted};
+		}
+	}
+
+	// Chunks draw from their own seeded generator, so the result does not depend on how many threads ran them
+	long chunks = (options.trials + CHUNK - 1) / CHUNK;
+	std::vector<Tally> tallies(chunks);
+	WorkerPool::inst().parallelFor(chunks, 1, [&](size_t begin, size_t end) {
+		for (size_t chunk = begin; chunk < end; chunk++) {
+			std::seed_seq seq{options.seed, (unsigned int)chunk};
+			std::mt19937 rng(seq);
+			std::uniform_int_distribution<int> roll(1, 100), member(0, size - 1);
+			Tally& tally = tallies[chunk];
+			long trials = std::min(CHUNK, options.trials - (long)chunk * CHUNK);
+			for (long trial = 0; trial < trials; trial++) {
+				int at = 0, code = start;
+				std::array<int, MAX_TEAM> state{};
+				for (int i = 0; i < size; i++) state[i] = health[i];
+				uint64_t seen = 1;
+				unsigned int woundedMask = 0;
+				for (int step = 0; step < options.depth; step++) {
+					const Node& current = nodes[at];
+					const Outcome& outcome = current.outcomes[code];
+					bool success = !outcome.disrupted && roll(rng) <= outcome.chance;
+					if (step == 0) {
+						tally.success += success;
+						tally.disrupted += outcome.disrupted;
+					}
+					int next = -1;
+					if (success) next = current.onSuccess;
+					else if (current.dangerous) {
+						int hurt = member(rng);
+						woundedMask |= 1u << hurt;
+						if (state[hurt] != Hero::DOWNED) {
+							state[hurt]++;
+							code += digit[hurt];
+						}
+						next = current.onFailure;
+					}
+					if (next < 0) break;
+					if (!(seen >> next & 1)) tally.reached[next]++;
+					seen |= uint64_t{1} << next;
+					at = next;
+				}
+				tally.anyWound += woundedMask != 0;
+				for (int i = 0; i < size; i++) {
+					tally.wounded[i] += woundedMask >> i & 1;
+					tally.downed[i] += state[i] == Hero::DOWNED;
+				}
+			}
+		}
+	});
+
+	Tally sum;
+	for (auto& tally : tallies) {
+		sum.success += tally.success;
+		sum.disrupted += tally.disrupted;
+		sum.anyWound += tally.anyWound;
+		for (int i = 0; i < size; i++) {
+			sum.wounded[i] += tally.wounded[i];
+			sum.downed[i] += tally.downed[i];
+		}
+		for (size_t n = 0; n < nodes.size(); n++) sum.reached[n] += tally.reached[n];
+	}
+	float trials = (float)options.trials;
+	Result result;
+	result.trials = options.trials;
+	result.success = sum.success / trials;
+	result.disrupted = sum.disrupted / trials;
+	result.anyWound = sum.anyWound / trials;
+	for (int i = 0; i < size; i++) {
+		result.wounded.push_back(sum.wounded[i] / trials);
+		result.downed.push_back(sum.downed[i] / trials);
+	}
+	for (size_t n = 1; n < nodes.size(); n++) if (sum.reached[n]) result.followUps.emplace_back(nodes[n].id, sum.reached[n] / trials);
+	std::stable_sort(BEGEND(result.followUps), [](auto& a, auto& b) { return a.second > b.second; });
+	return result;
+}
@@ -0,0 +1,173 @@
+#include <algorithm>
+#include <atomic>
+#include <limits>
+#include <stdexcept>
+
+#include <Utils.hpp>
+#include <TeamScorer.hpp>
+#include <Hero.hpp>
+#include <HeroesHandler.hpp>
+#include <WorkerPool.hpp>
+
+namespace {
+	constexpr int COUNT = Attribute::COUNT;
+	// Below this many teams the search runs inline
+	constexpr unsigned long long PARALLEL_TEAMS = 20000;
+
+	struct Candidate {
+		int score;
+		std::array<int, TeamScorer::MAX_SLOTS> members;
+	};
+	bool better(const Candidate& a, const Candidate& b) { return a.score != b.score ? a.score > b.score : a.members < b.members; }
+}
+
+void TeamScorer::pack(const std::vector<HeroId>& heroes) {
+	auto& hh = HeroesHandler::inst();
+	pool = heroes;
+	stride = (pool.size() + 7) / 8 * 8;
+	columns.assign(COUNT * stride, 0);
+	for (size_t i = 0; i < pool.size(); i++) {
+		AttrMap<int> values = hh[pool[i]].soloAttributes();
+		for (int a = 0; a < COUNT; a++) columns[a * stride + i] = values[Attribute::Values[a]];
+	}
+}
+void TeamScorer::packAvailable() {
+	auto& hh = HeroesHandler::inst();
+	std::vector<HeroId> heroes;
+	for (HeroId id : hh.roster) if (hh[id].status() == Hero::AVAILABLE && hh[id].health != Hero::DOWNED) heroes.push_back(id);
+	pack(heroes);
+}
+
+void TeamScorer::score(const AttrMap<int>& required, const std::vector<int>& teams, int size, std::vector<int>& out) const {
+	if (size < 1 || size > MAX_SLOTS || teams.size() % size) throw std::invalid_argument("TeamScorer::score needs 1 to 4 members per team");
+	int req[COUNT];
+	for (int a = 0; a < COUNT; a++) req[a] = required[Attribute::Values[a]];
+	out.resize(teams.size() / size);
+	for (size_t team = 0; team < out.size(); team++) {
+		const int* members = teams.data() + team * size;
+		int total[COUNT]{};
+		for (int i = 0; i < size; i++) {
+			if (members[i] < 0) continue;
+			if (members[i] >= (int)pool.size()) throw std::out_of_range("TeamScorer::score got a hero outside the pool");
+			for (int a = 0; a < COUNT; a++) total[a] += columns[a * stride + members[i]];
+		}
+		int score = 0;
+		for (int a = 0; a < COUNT; a++) score += std::min(total[a], req[a]);
+		out[team] = score;
+	}
+}
+
+// Branch and bound over teams in pool order, one task per first member. A partial team is dropped when even the
+// best remaining heroes couldn't lift it to the worst kept team. Kept teams only ever get better, and the floor shared
+// between tasks only drops teams that are strictly worse, so the result doesn't depend on the thread count.
+std::vector<TeamScorer::Team> TeamScorer::best(const AttrMap<int>& required, int slots, size_t k) const {
+	if (slots < 1 || slots > MAX_SLOTS) throw std::invalid_argument("TeamScorer teams have 1 to 4 slots");
+	int n = (int)pool.size();
+	int size = std::min(slots, n);
+	if (n == 0 || k == 0) return {};
+	k = std::min<unsigned long long>(k, combinations(n, size));
+
+	int req[COUNT], requiredTotal = 0;
+	for (int a = 0; a < COUNT; a++) requiredTotal += req[a] = required[Attribute::Values[a]];
+	// Highest value in each column from an index on
+	std::vector<int> highest(COUNT * (n + 1), std::numeric_limits<int>::min() / 8);
+	for (int a = 0; a < COUNT; a++) for (int i = n - 1; i >= 0; i--) highest[a * (n + 1) + i] = std::max(columns[a * stride + i], highest[a * (n + 1) + i + 1]);
+
+	size_t tasks = n - size + 1;
+	// One heap per task with the worst kept team on top, grown only as teams make it in
+	std::vector<std::vector<Candidate>> kept(tasks);
+	std::atomic<int> floor{std::numeric_limits<int>::min()};
+	auto raiseFloor = [&](int score) {
+		int current = floor.load(std::memory_order_relaxed);
+		while (current < score && !floor.compare_exchange_weak(current, score, std::memory_order_relaxed));
+	};
+
+	size_t chunk = combinations(n, size) < PARALLEL_TEAMS ? tasks : 1;
+	WorkerPool::inst().parallelFor(tasks, chunk, [&](size_t begin, size_t end) {
+		std::vector<int> scores(n);
+		for (size_t first = begin; first < end; first++) {
+			std::vector<Candidate>& heap = kept[first];
+			Candidate current{0, {(int)first, -1, -1, -1}};
+			int sum[MAX_SLOTS][COUNT];
+			for (int a = 0; a < COUNT; a++) sum[0][a] = columns[a * stride + first];
+
+			// Teams come up in pool order, so once the heap is full a later team has to beat its worst outright
+			auto cut = [&] { return heap.size() == k ? std::max(heap.front().score + 1, floor.load(std::memory_order_relaxed)) : floor.load(std::memory_order_relaxed); };
+			auto offer = [&](int score) {
+				current.score = score;
+				if (heap.size() < k) {
+					heap.push_back(current);
+					std::push_heap(BEGEND(heap), better);
+				} else if (better(current, heap.front())) {
+					std::pop_heap(BEGEND(heap), better);
+					heap.back() = current;
+					std::push_heap(BEGEND(heap), better);
+				} else return;
+				if (heap.size() == k) raiseFloor(heap.front().score);
+			};
+			auto bound = [&](const int* partial, int from, int left) {
+				int score = 0;
+				for (int a = 0; a < COUNT; a++) score += std::min(partial[a] + left * highest[a * (n + 1) + from], req[a]);
+				return score;
+			};
+			auto descend = [&](auto& self, int level, int from) -> void {
+				const int* partial = sum[level - 1];
+				if (level == size - 1) {
+					// Column by column over every last member, the scan below only looks at the ones that make the cut
+					std::fill(scores.begin() + from, scores.begin() + n, 0);
+					for (int a = 0; a < COUNT; a++) {
+						const int* col = columns.data() + a * stride;
+						int base = partial[a], cap = req[a];
+						for (int last = from; last < n; last++) scores[last] += std::min(base + col[last], cap);
+					}
+					int threshold = cut();
+					for (int last = from; last < n; last++) {
+						if (scores[last] < threshold) continue;
+						current.members[level] = last;
+						offer(scores[last]);
+						threshold = cut();
+					}
+					return;
+				}
+				for (int next = from; next <= n - (size - level); next++) {
+					for (int a = 0; a < COUNT; a++) sum[level][a] = partial[a] + columns[a * stride + next];
+					if (bound(sum[level], next + 1, size - level - 1) < cut()) continue;
+					current.members[level] = next;
+					self(self, level + 1, next + 1);
+				}
+			};
+
+			if (size == 1) {
+				int score = 0;
+				for (int a = 0; a < COUNT; a++) score += std::min(sum[0][a], req[a]);
+				offer(score);
+			} else if (bound(sum[0], first + 1, size - 1) >= cut()) descend(descend, 1, first + 1);
+		}
+	});
+
+	std::vector<Candidate> merged;
+	for (auto& heap : kept) merged.insert(merged.end(), BEGEND(heap));
+	size_t keep = std::min(k, merged.size());
+	std::partial_sort(merged.begin(), merged.begin() + keep, merged.end(), better);
+	std::vector<Team> teams;
+	teams.reserve(keep);
+	for (size_t i = 0; i < keep; i++) {
+		Team team;
+		team.size = size;
+		team.score = merged[i].score;
+		team.chance = requiredTotal == 0 ? 100 : team.score * 100 / requiredTotal;
+		for (int m = 0; m < size; m++) team.heroes[m] = pool[merged[i].members[m]];
+		teams.push_back(team);
+	}
+	return teams;
+}
+
+unsigned long long TeamScorer::combinations(size_t n, int k) {
+	if (k < 0 || (size_t)k > n) return 0;
+	unsigned long long result = 1;
+	for (int i = 0; i < k; i++) {
+		if (result > std::numeric_limits<unsigned long long>::max() / (n - i)) return std::numeric_limits<unsigned long long>::max();
+		result = result * (n - i) / (i + 1);
+	}
+	return result;
+}
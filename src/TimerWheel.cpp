@@ -0,0 +1,139 @@
+#include <algorithm>
+#include <tuple>
+
+#include <Utils.hpp>
+#include <TimerWheel.hpp>
+
+TimerWheel& TimerWheel::inst() {
+	static TimerWheel singleton;
+	return singleton;
+}
+
+TimerHandle TimerWheel::schedule(float delay, std::function<void()> callback) { return scheduleAt(time + std::max(delay, 0.0f), std::move(callback)); }
+TimerHandle TimerWheel::scheduleAt(double when, std::function<void()> callback) {
+	uint32_t index;
+	if (freeList.empty()) {
+		index = (uint32_t)timers.size();
+		timers.emplace_back();
+	} else {
+		index = freeList.back();
+		freeList.pop_back();
+	}
+	Timer& timer = timers[index];
+	timer.deadline = when;
+	timer.tick = when > 0.0 ? (uint64_t)(when * TICKS_PER_SECOND) : 0;
+	timer.live = true;
+	timer.callback = std::move(callback);
+	insert(index);
+	count++;
+	return {index, timer.generation};
+}
+
+bool TimerWheel::pending(TimerHandle handle) const {
+	return handle.valid() && handle.index < timers.size() && timers[handle.index].live && timers[handle.index].generation == handle.generation;
+}
+double TimerWheel::deadline(TimerHandle handle) const { return pending(handle) ? timers[handle.index].deadline : std::numeric_limits<double>::infinity(); }
+// Within a level, slots from the cursor on hold later and later ticks, so only the first occupied one is looked into.
+// A level's own cursor slot was cascaded when the cursor entered it, above level 0 anything there is a full turn ahead.
+double TimerWheel::nextDeadline() const {
+	double next = std::numeric_limits<double>::infinity();
+	auto earliest = [&](uint32_t bucket) {
+		for (uint32_t index : buckets[bucket]) next = std::min(next, timers[index].deadline);
+		return !buckets[bucket].empty();
+	};
+	for (int level = 0; level < LEVELS; level++) {
+		uint32_t cursor = (current >> (SLOT_BITS * level)) & (SLOTS - 1), first = level == 0 ? 0 : 1;
+		for (uint32_t step = first; step < first + SLOTS; step++) if (earliest(level * SLOTS + ((cursor + step) & (SLOTS - 1)))) break;
+	}
+	earliest(FAR_BUCKET);
+	return next;
+}
+void TimerWheel::cancel(TimerHandle& handle) {
+	if (pending(handle)) {
+		remove(handle.index);
+		release(handle.index);
+	}
+	handle = {};
+}
+
+// Deadlines in the past or in the current tick go to the current slot, the rest to the lowest level whose range covers them
+void TimerWheel::insert(uint32_t index) {
+	Timer& timer = timers[index];
+	uint64_t tick = std::max(timer.tick, current);
+	uint64_t delta = tick - current;
+	timer.bucket = FAR_BUCKET;
+	for (int level = 0; level < LEVELS; level++) {
+		if (delta < (uint64_t{1} << (SLOT_BITS * (level + 1)))) {
+			timer.bucket = level * SLOTS + ((tick >> (SLOT_BITS * level)) & (SLOTS - 1));
+			break;
+		}
+	}
+	timer.pos = (uint32_t)buckets[timer.bucket].size();
+	buckets[timer.bucket].push_back(index);
+}
+void TimerWheel::remove(uint32_t index) {
+	Timer& timer = timers[index];
+	auto& bucket = buckets[timer.bucket];
+	uint32_t last = bucket.back();
+	bucket[timer.pos] = last;
+	timers[last].pos = timer.pos;
+	bucket.pop_back();
+}
+void TimerWheel::release(uint32_t index) {
+	Timer& timer = timers[index];
+	timer.live = false;
+	timer.callback = nullptr;
+	timer.generation++;
+	freeList.push_back(index);
+	count--;
+}
+void TimerWheel::rebucket(uint32_t bucket) {
+	moving.swap(buckets[bucket]);
+	for (uint32_t index : moving) insert(index);
+	moving.clear();
+}
+
+// Runs the due timers of the current slot in deadline order, again if the callbacks scheduled more that are already due
+void TimerWheel::fire(double end) {
+	auto& bucket = buckets[current & (SLOTS - 1)];
+	while (true) {
+		firing.clear();
+		for (uint32_t index : bucket) if (timers[index].deadline <= end) firing.push_back({index, timers[index].generation});
+		if (firing.empty()) return;
+		std::sort(BEGEND(firing), [&](TimerHandle a, TimerHandle b) { return std::tie(timers[a.index].deadline, a.index) < std::tie(timers[b.index].deadline, b.index); });
+		for (TimerHandle handle : firing) {
+			// An earlier callback may have cancelled it
+			if (!pending(handle)) continue;
+			Timer& timer = timers[handle.index];
+			time = std::max(time, timer.deadline);
+			std::function<void()> callback = std::move(timer.callback);
+			remove(handle.index);
+			release(handle.index);
+			callback();
+		}
+	}
+}
+
+void TimerWheel::advance(float deltaTime) {
+	double end = time + std::max(deltaTime, 0.0f);
+	uint64_t target = (uint64_t)(end * TICKS_PER_SECOND);
+	// Timers later in the current tick were left by the last call
+	fire(end);
+	while (current < target) {
+		current++;
+		// Outer levels first, what they hand down may land in the slot cascaded right after
+		for (int level = LEVELS; level >= 1; level--) {
+			if (current & ((uint64_t{1} << (SLOT_BITS * level)) - 1)) continue;
+			rebucket(level == LEVELS ? FAR_BUCKET : level * SLOTS + ((current >> (SLOT_BITS * level)) & (SLOTS - 1)));
+		}
+		fire(end);
+	}
+	time = end;
+}
+
+void TimerWheel::clear() {
+	for (uint32_t index = 0; index < timers.size(); index++) if (timers[index].live) release(index);
+	for (auto& bucket : buckets) bucket.clear();
+	time = 0.0;
+	current = 0;
+}
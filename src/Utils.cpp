@@ -56,6 +56,11 @@ namespace Utils {
 		std::uniform_int_distribution<> dist(low, high);
 		return dist(gen);
 	}
+	double randDouble(double low, double high) {
+		static std::mt19937 gen(std::random_device{}());
+		std::uniform_real_distribution<> dist(low, high);
+		return dist(gen);
+	}
 
 	std::vector<int> range(int start, int end, int step) {
 		if (step == 0) throw std::invalid_argument("Step cannot be zero");
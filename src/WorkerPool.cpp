@@ -0,0 +1,80 @@
+#include <algorithm>
+
+#include <WorkerPool.hpp>
+
+WorkerPool::WorkerPool() {
+	unsigned int hardware = std::thread::hardware_concurrency();
+	start(hardware > 1 ? hardware - 1 : 0);
+}
+WorkerPool::~WorkerPool() { stop(); }
+
+WorkerPool& WorkerPool::inst() {
+	static WorkerPool singleton;
+	return singleton;
+}
+
+void WorkerPool::start(size_t threads) {
+	stopping = false;
+	// New workers wait for the next run, not one that already went by before a resize
+	for (size_t i = 0; i < threads; i++) workers.emplace_back(&WorkerPool::loop, this, generation);
+}
+void WorkerPool::stop() {
+	{
+		std::lock_guard lock(mutex);
+		stopping = true;
+	}
+	wake.notify_all();
+	for (auto& worker : workers) worker.join();
+	workers.clear();
+}
+void WorkerPool::resize(size_t threads) {
+	if (threads == workers.size()) return;
+	stop();
+	start(threads);
+}
+
+// Claims chunks until none are left, the first exception is kept and the remaining chunks are skipped
+void WorkerPool::work() {
+	for (size_t begin = next.fetch_add(grain); begin < count; begin = next.fetch_add(grain)) {
+		try {
+			job(ctx, begin, std::min(begin + grain, count));
+		} catch (...) {
+			std::lock_guard lock(mutex);
+			if (!error) error = std::current_exception();
+			next = count;
+		}
+	}
+}
+void WorkerPool::loop(unsigned long seen) {
+	while (true) {
+		{
+			std::unique_lock lock(mutex);
+			wake.wait(lock, [&]{ return stopping || generation != seen; });
+			if (stopping) return;
+			seen = generation;
+		}
+		work();
+		{
+			std::lock_guard lock(mutex);
+			if (--busy == 0) done.notify_one();
+		}
+	}
+}
+void WorkerPool::run(size_t n, size_t chunk, Job fn, void* context) {
+	{
+		std::lock_guard lock(mutex);
+		job = fn;
+		ctx = context;
+		count = n;
+		grain = chunk;
+		next = 0;
+		error = nullptr;
+		busy = workers.size();
+		generation++;
+	}
+	wake.notify_all();
+	work();
+	std::unique_lock lock(mutex);
+	done.wait(lock, [&]{ return busy == 0; });
+	if (error) std::rethrow_exception(error);
+}